@@ -0,0 +1,287 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <fcntl.h>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "microbench.h"
+/* trace.h 只在定义了 TRACE_ENABLED 时才有实现 */
+#define TRACE_ENABLED
+#include "../concurrency/practice/async_logger.h"
+#include "../concurrency/practice/simple_thread_pool.h"
+#include "../concurrency/practice/trace.h"
+#include "../language_runtime_enhance/function_object_wrapper/unique_function.h"
+
+/**
+ * @brief concurrency/ 下各个示例对应的基准测试
+ * 名字的前缀是示例的文件名，测量的是示例演示的那个操作本身的开销
+ * concurrency/practice/ 下的组件直接测量头文件中的实现，旁边放一条它要替换的标准库写法（名字带 std_）
+ * 编译：g++ -std=c++17 -O2 -pthread benchmark/concurrency_bench.cc -o concurrency_bench
+ */
+
+/* ---- atomic.cc：原子加 ---- */
+BENCHMARK("atomic/fetch_add_seq_cst", [](mb::state &st) {
+  std::atomic<int> count{10};
+  for(auto _ : st)
+    count.fetch_add(1);
+  mb::do_not_optimize(count);
+});
+
+BENCHMARK("atomic/plain_increment", [](mb::state &st) {
+  int count = 10;
+  for(auto _ : st) {
+    ++count;
+    mb::do_not_optimize(count);
+  }
+});
+
+/* ---- memory_order.cc：不同内存序下的读写 ---- */
+BENCHMARK("memory_order/fetch_add_relaxed", [](mb::state &st) {
+  std::atomic<int> counter{0};
+  for(auto _ : st)
+    counter.fetch_add(1, std::memory_order_relaxed);
+  mb::do_not_optimize(counter);
+});
+
+BENCHMARK("memory_order/store_release_load_acquire", [](mb::state &st) {
+  std::atomic<int> flag{0};
+  int v = 0;
+  for(auto _ : st) {
+    flag.store(v, std::memory_order_release);
+    v = flag.load(std::memory_order_acquire) + 1;
+  }
+  mb::do_not_optimize(v);
+});
+
+BENCHMARK("memory_order/store_seq_cst_load_seq_cst", [](mb::state &st) {
+  std::atomic<int> flag{0};
+  int v = 0;
+  for(auto _ : st) {
+    flag.store(v);
+    v = flag.load() + 1;
+  }
+  mb::do_not_optimize(v);
+});
+
+/* ---- lock.cc：无竞争时加锁解锁 ---- */
+BENCHMARK("lock/lock_guard", [](mb::state &st) {
+  std::mutex mtx;
+  int v = 0;
+  for(auto _ : st) {
+    std::lock_guard<std::mutex> lock(mtx);
+    ++v;
+  }
+  mb::do_not_optimize(v);
+});
+
+BENCHMARK("lock/unique_lock_unlock_relock", [](mb::state &st) {
+  std::mutex mtx;
+  int v = 0;
+  for(auto _ : st) {
+    std::unique_lock<std::mutex> lock(mtx);
+    ++v;
+    lock.unlock();
+    lock.lock();
+    ++v;
+  }
+  mb::do_not_optimize(v);
+});
+
+/* ---- condition_variable.cc：生产者和消费者之间交接一个元素（一次往返） ---- */
+BENCHMARK("condition_variable/ping_pong", [](mb::state &st) {
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::queue<int> produced, consumed;
+  bool done = false;
+  std::thread consumer([&] {
+    std::unique_lock<std::mutex> lock(mtx);
+    for(;;) {
+      cv.wait(lock, [&] { return done || !produced.empty(); });
+      if(done)
+        return;
+      consumed.push(produced.front());
+      produced.pop();
+      cv.notify_all();
+    }
+  });
+  for(auto _ : st) {
+    std::unique_lock<std::mutex> lock(mtx);
+    produced.push(1);
+    cv.notify_all();
+    cv.wait(lock, [&] { return !consumed.empty(); });
+    consumed.pop();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    done = true;
+  }
+  cv.notify_all();
+  consumer.join();
+});
+
+/* ---- future.cc：packaged_task 和期物 ---- */
+BENCHMARK("future/packaged_task_same_thread", [](mb::state &st) {
+  int sum = 0;
+  for(auto _ : st) {
+    std::packaged_task<int()> task([] { return 7; });
+    std::future<int> result = task.get_future();
+    task();
+    sum += result.get();
+  }
+  mb::do_not_optimize(sum);
+});
+
+BENCHMARK("future/packaged_task_on_new_thread", [](mb::state &st) {
+  int sum = 0;
+  for(auto _ : st) {
+    std::packaged_task<int()> task([] { return 7; });
+    std::future<int> result = task.get_future();
+    std::thread(std::move(task)).detach();
+    sum += result.get();
+  }
+  mb::do_not_optimize(sum);
+});
+
+/* ---- async.cc：std::async 的两种启动策略 ---- */
+BENCHMARK("async/launch_async", [](mb::state &st) {
+  int sum = 0;
+  for(auto _ : st)
+    sum += std::async(std::launch::async, [] { return 1; }).get();
+  mb::do_not_optimize(sum);
+});
+
+BENCHMARK("async/launch_deferred", [](mb::state &st) {
+  int sum = 0;
+  for(auto _ : st)
+    sum += std::async(std::launch::deferred, [] { return 1; }).get();
+  mb::do_not_optimize(sum);
+});
+
+/* ---- unique_function.h：线程池的任务型别，构造并调用一次；对照 std::function ---- */
+BENCHMARK("unique_function/std_function_small", [](mb::state &st) {
+  int sum = 0;
+  for(auto _ : st) {
+    std::function<int(int)> f = [k = sum & 7](int x) { return x + k; };
+    mb::do_not_optimize(f);
+    sum += f(1);
+  }
+  mb::do_not_optimize(sum);
+});
+
+BENCHMARK("unique_function/small", [](mb::state &st) {
+  int sum = 0;
+  for(auto _ : st) {
+    unique_function<int(int)> f = [k = sum & 7](int x) { return x + k; };
+    mb::do_not_optimize(f);
+    sum += f(1);
+  }
+  mb::do_not_optimize(sum);
+});
+
+/* 捕获 unique_ptr：std::function 只能绕道 shared_ptr */
+BENCHMARK("unique_function/std_function_shared_state", [](mb::state &st) {
+  int sum = 0;
+  for(auto _ : st) {
+    std::function<int()> f = [p = std::make_shared<int>(1)] { return *p; };
+    sum += f();
+  }
+  mb::do_not_optimize(sum);
+});
+
+BENCHMARK("unique_function/move_only_state", [](mb::state &st) {
+  int sum = 0;
+  for(auto _ : st) {
+    unique_function<int()> f = [p = std::make_unique<int>(1)] { return *p; };
+    sum += f();
+  }
+  mb::do_not_optimize(sum);
+});
+
+/* ---- simple_thread_pool.cc：提交一个任务并等待结果；对照每个任务创建并回收一个线程 ---- */
+BENCHMARK("simple_thread_pool/std_thread_per_task", [](mb::state &st) {
+  std::atomic<int> sum{0};
+  for(auto _ : st)
+    std::thread([&sum] { sum.fetch_add(1, std::memory_order_relaxed); }).join();
+  mb::do_not_optimize(sum);
+});
+
+BENCHMARK("simple_thread_pool/submit_get", [](mb::state &st) {
+  ThreadPool pool(2);
+  int sum = 0;
+  for(auto _ : st)
+    sum += pool.submit([] { return 1; }).get();
+  mb::do_not_optimize(sum);
+});
+
+/* 只投递不等待，计时只覆盖入队；剩下的任务在 pool 析构时排空，不计入 */
+BENCHMARK("simple_thread_pool/post", [](mb::state &st) {
+  std::atomic<int> sum{0};
+  {
+    ThreadPool pool(2);
+    for(auto _ : st)
+      pool.post([&sum] { sum.fetch_add(1, std::memory_order_relaxed); });
+  }
+  mb::do_not_optimize(sum);
+});
+
+/* ---- async_logger.cc：调用者一侧的开销；对照格式化后写入文件并立即刷新 ---- */
+BENCHMARK("async_logger/std_fprintf_fflush", [](mb::state &st) {
+  std::FILE *f = std::fopen("/dev/null", "w");
+  int i = 0;
+  for(auto _ : st) {
+    std::fprintf(f, "request %d took %.3f ms from %s\n", i++, 1.25, "127.0.0.1");
+    std::fflush(f);
+  }
+  std::fclose(f);
+});
+
+/* drop 策略：后台线程跟不上时丢弃，测量的是调用者写入环形缓冲区本身 */
+BENCHMARK("async_logger/alog_drop", [](mb::state &st) {
+  int fd = ::open("/dev/null", O_WRONLY);
+  auto &log = alog::logger::instance();
+  log.start(fd, alog::overflow::drop);
+  int i = 0;
+  for(auto _ : st) {
+    ALOG("request {} took {} ms from {}", i, 1.25, "127.0.0.1");
+    ++i;
+  }
+  log.flush();
+  log.stop();
+  ::close(fd);
+});
+
+/* block 策略：缓冲区满时等待后台线程，持续写入时受限于后台线程的格式化速度 */
+BENCHMARK("async_logger/alog_block", [](mb::state &st) {
+  int fd = ::open("/dev/null", O_WRONLY);
+  auto &log = alog::logger::instance();
+  log.start(fd, alog::overflow::block);
+  int i = 0;
+  for(auto _ : st) {
+    ALOG("request {} took {} ms from {}", i, 1.25, "127.0.0.1");
+    ++i;
+  }
+  log.flush();
+  log.stop();
+  ::close(fd);
+});
+
+/* ---- trace.h：记录一个区间和一个时刻，写入当前线程的环形缓冲区 ---- */
+BENCHMARK("trace/scope", [](mb::state &st) {
+  for(auto _ : st) {
+    TRACE_SCOPE("bench");
+    mb::clobber_memory();
+  }
+});
+
+BENCHMARK("trace/instant", [](mb::state &st) {
+  for(auto _ : st)
+    TRACE_INSTANT("bench");
+});
+
+MB_MAIN()
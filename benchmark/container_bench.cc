@@ -0,0 +1,152 @@
+#include <array>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <variant>
+#include <vector>
+#include "microbench.h"
+
+/**
+ * @brief container/ 下各个示例对应的基准测试
+ * 编译：g++ -std=c++17 -O2 benchmark/container_bench.cc -o container_bench
+ */
+
+/* ---- array.cc：固定大小的 std::array 与按需扩张的 std::vector ---- */
+BENCHMARK("array/std_array_sum_4", [](mb::state &st) {
+  std::array<int, 4> arr = {1, 2, 3, 4};
+  int sum = 0;
+  for(auto _ : st) {
+    mb::do_not_optimize(arr);
+    sum += std::accumulate(arr.begin(), arr.end(), 0);
+  }
+  mb::do_not_optimize(sum);
+});
+
+BENCHMARK("array/vector_construct_sum_4", [](mb::state &st) {
+  int sum = 0;
+  for(auto _ : st) {
+    std::vector<int> v = {1, 2, 3, 4};
+    mb::do_not_optimize(v.data());
+    sum += std::accumulate(v.begin(), v.end(), 0);
+  }
+  mb::do_not_optimize(sum);
+});
+
+BENCHMARK("array/vector_push_back_1000", [](mb::state &st) {
+  for(auto _ : st) {
+    std::vector<int> v;
+    for(int i = 0; i < 1000; ++i)
+      v.push_back(i);
+    mb::do_not_optimize(v.data());
+  }
+});
+
+BENCHMARK("array/vector_reserve_push_back_1000", [](mb::state &st) {
+  for(auto _ : st) {
+    std::vector<int> v;
+    v.reserve(1000);
+    for(int i = 0; i < 1000; ++i)
+      v.push_back(i);
+    mb::do_not_optimize(v.data());
+  }
+});
+
+/* ---- 运行期索引 tuple，与 runtime_index.cc 中的实现相同 ---- */
+template<std::size_t n, typename... T>
+constexpr std::variant<T...> _tuple_index(const std::tuple<T...> &tpl, std::size_t i) {
+  if constexpr(n >= sizeof...(T))
+    throw std::out_of_range("越界.");
+  if(i == n)
+    return std::variant<T...>{std::in_place_index<n>, std::get<n>(tpl)};
+  return _tuple_index<(n < sizeof...(T) - 1 ? n + 1 : 0)>(tpl, i);
+}
+
+template<typename... T>
+constexpr std::variant<T...> tuple_index(const std::tuple<T...> &tpl, std::size_t i) {
+  return _tuple_index<0>(tpl, i);
+}
+
+/* ---- tuple.cc：返回 tuple 后拆包 ---- */
+__attribute__((noinline)) std::tuple<double, char, std::string> get_student(int id) {
+  if(id == 0)
+    return std::make_tuple(3.8, 'A', "张三");
+  return std::make_tuple(2.9, 'C', "李四");
+}
+
+BENCHMARK("tuple/make_tuple_and_tie", [](mb::state &st) {
+  double gpa = 0;
+  char grade;
+  std::string name;
+  int id = 0;
+  for(auto _ : st) {
+    std::tie(gpa, grade, name) = get_student(id ^= 1);
+    mb::do_not_optimize(gpa);
+  }
+});
+
+BENCHMARK("tuple/structured_binding", [](mb::state &st) {
+  int id = 0;
+  for(auto _ : st) {
+    auto [gpa, grade, name] = get_student(id ^= 1);
+    mb::do_not_optimize(gpa);
+    mb::do_not_optimize(grade);
+  }
+});
+
+/* ---- runtime_index.cc：运行期下标访问 tuple ---- */
+BENCHMARK("runtime_index/tuple_index_variant", [](mb::state &st) {
+  std::tuple<int, int, double> t(1, 2, 1.1);
+  std::size_t i = 0;
+  double sum = 0;
+  for(auto _ : st) {
+    mb::do_not_optimize(i);
+    sum += std::visit([](auto x) { return static_cast<double>(x); }, tuple_index(t, i));
+    i = i == 2 ? 0 : i + 1;
+  }
+  mb::do_not_optimize(sum);
+});
+
+BENCHMARK("runtime_index/switch_baseline", [](mb::state &st) {
+  std::tuple<int, int, double> t(1, 2, 1.1);
+  std::size_t i = 0;
+  double sum = 0;
+  for(auto _ : st) {
+    mb::do_not_optimize(i);
+    switch(i) {
+      case 0: sum += std::get<0>(t); break;
+      case 1: sum += std::get<1>(t); break;
+      default: sum += std::get<2>(t); break;
+    }
+    i = i == 2 ? 0 : i + 1;
+  }
+  mb::do_not_optimize(sum);
+});
+
+/* ---- merge_and_traverse.cc：tuple_cat 后遍历 ---- */
+BENCHMARK("merge_and_traverse/tuple_cat_runtime_index", [](mb::state &st) {
+  std::tuple<double, char, int> t1{1.1, 'A', 3};
+  std::tuple<double, char, int> t2{2.2, 'B', 4};
+  double sum = 0;
+  for(auto _ : st) {
+    mb::do_not_optimize(t1);
+    auto t = std::tuple_cat(t1, t2);
+    for(std::size_t i = 0; i != std::tuple_size<decltype(t)>::value; ++i)
+      sum += std::visit([](auto x) { return static_cast<double>(x); }, tuple_index(t, i));
+  }
+  mb::do_not_optimize(sum);
+});
+
+BENCHMARK("merge_and_traverse/tuple_cat_apply_fold", [](mb::state &st) {
+  std::tuple<double, char, int> t1{1.1, 'A', 3};
+  std::tuple<double, char, int> t2{2.2, 'B', 4};
+  double sum = 0;
+  for(auto _ : st) {
+    mb::do_not_optimize(t1);
+    auto t = std::tuple_cat(t1, t2);
+    sum += std::apply([](auto... x) { return (0.0 + ... + static_cast<double>(x)); }, t);
+  }
+  mb::do_not_optimize(sum);
+});
+
+MB_MAIN()
@@ -0,0 +1,488 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief 仓库内的微基准测试框架
+ * 只有一个头文件，每个 xxx_bench.cc 包含它，用 BENCHMARK 注册测试，最后写 MB_MAIN()：
+ *
+ *   BENCHMARK("lock/lock_guard", [](mb::state &st) {
+ *     for(auto _ : st) { ... mb::do_not_optimize(x); }
+ *   });
+ *
+ * 1. 计时只覆盖 for(auto _ : st) 循环本身，循环之前的准备工作不计入
+ * 2. 先倍增迭代次数直到一次采样达到目标时长，再预热，然后采集若干次采样，报告每次迭代耗时的中位数和 p10/p90/p99
+ * 3. Linux 上用 perf_event_open 读取 cycles、instructions、cache misses、branch misses（按迭代平均），
+ *    内核不允许（perf_event_paranoid、容器、虚拟机）时只报告时间
+ * 4. --json=FILE 写出结果，--baseline=FILE 与之前保存的结果比较中位数，超过 --threshold 百分比的变慢记为回归，
+ *    有回归时进程返回 1，可以直接用在脚本里
+ *
+ * 其它参数：--filter=子串  --min-time=毫秒（每个测试的采样总时长）  --samples=N  --no-counters  --list
+ */
+
+namespace mb {
+
+/* 让编译器认为 value 被读取（以及可能被修改），阻止计算被优化掉 */
+template<typename T>
+inline void do_not_optimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+template<typename T>
+inline void do_not_optimize(T &value) {
+  if constexpr(std::is_trivially_copyable_v<T> && sizeof(T) <= sizeof(void*))
+    asm volatile("" : "+r,m"(value) : : "memory");
+  else
+    asm volatile("" : "+m"(value) : : "memory");
+}
+/* 让编译器认为所有内存都可能被读写，阻止写操作被合并或者删除 */
+inline void clobber_memory() { asm volatile("" : : : "memory"); }
+
+using clock = std::chrono::steady_clock;
+
+/* ------------------------------ 硬件计数器 ------------------------------ */
+class perf_counters {
+public:
+  static constexpr int kEvents = 4;
+  static constexpr const char *names[kEvents] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+
+  perf_counters() {
+#ifdef __linux__
+    const std::uint64_t configs[kEvents] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for(int i = 0; i < kEvents; ++i) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[i];
+      attr.disabled = 1;
+      attr.inherit = 1;  // 测试中创建的线程也计入
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+      if(fds[i] < 0) {
+        error = std::string(names[i]) + ": " + std::strerror(errno);
+        close_all();
+        return;
+      }
+    }
+#else
+    error = "perf_event_open is only available on Linux";
+#endif
+  }
+  ~perf_counters() { close_all(); }
+  perf_counters(const perf_counters&) = delete;
+  perf_counters& operator=(const perf_counters&) = delete;
+
+  bool available() const noexcept { return error.empty(); }
+  const std::string& unavailable_reason() const noexcept { return error; }
+
+  void reset() { control(PERF_EVENT_IOC_RESET_); }
+  void enable() { control(PERF_EVENT_IOC_ENABLE_); }
+  void disable() { control(PERF_EVENT_IOC_DISABLE_); }
+
+  /* 计数器多于硬件寄存器时内核会轮流计数，按 enabled / running 的比例放大 */
+  bool read(double (&out)[kEvents]) const {
+#ifdef __linux__
+    if(!available())
+      return false;
+    for(int i = 0; i < kEvents; ++i) {
+      std::uint64_t v[3] = {0, 0, 0};
+      if(::read(fds[i], v, sizeof(v)) != static_cast<ssize_t>(sizeof(v)) || v[2] == 0)
+        return false;
+      out[i] = static_cast<double>(v[0]) * static_cast<double>(v[1]) / static_cast<double>(v[2]);
+    }
+    return true;
+#else
+    (void)out;
+    return false;
+#endif
+  }
+
+private:
+#ifdef __linux__
+  static constexpr unsigned long PERF_EVENT_IOC_RESET_ = PERF_EVENT_IOC_RESET;
+  static constexpr unsigned long PERF_EVENT_IOC_ENABLE_ = PERF_EVENT_IOC_ENABLE;
+  static constexpr unsigned long PERF_EVENT_IOC_DISABLE_ = PERF_EVENT_IOC_DISABLE;
+#else
+  static constexpr unsigned long PERF_EVENT_IOC_RESET_ = 0, PERF_EVENT_IOC_ENABLE_ = 0, PERF_EVENT_IOC_DISABLE_ = 0;
+#endif
+
+  void control(unsigned long request) {
+#ifdef __linux__
+    if(available())
+      for(int fd : fds)
+        ioctl(fd, request, 0);
+#else
+    (void)request;
+#endif
+  }
+
+  void close_all() {
+#ifdef __linux__
+    for(int &fd : fds)
+      if(fd >= 0) {
+        ::close(fd);
+        fd = -1;
+      }
+#endif
+  }
+
+  int fds[kEvents] = {-1, -1, -1, -1};
+  std::string error;
+};
+
+/* ------------------------------ 测试状态 ------------------------------ */
+class state {
+public:
+  state(std::uint64_t iterations, perf_counters *counters) : n(iterations), counters(counters) {}
+
+  /* for(auto _ : st) 中的 _ 不会触发 -Wunused-variable */
+  struct __attribute__((unused)) value {};
+
+  /* 计时在 begin 迭代器析构时结束：循环正常结束、break、return 或者抛出异常都会走到这里 */
+  struct iterator {
+    std::uint64_t left;
+    state *st;  // 只有 begin() 返回的迭代器非空
+
+    iterator(std::uint64_t left, state *st) noexcept : left(left), st(st) {}
+    iterator(const iterator&) = delete;
+    iterator& operator=(const iterator&) = delete;
+    ~iterator() {
+      if(st)
+        st->finish(left);
+    }
+
+    value operator*() const noexcept { return {}; }
+    void operator++() noexcept { --left; }
+    bool operator!=(const iterator&) const noexcept { return left != 0; }
+  };
+
+  iterator begin() {
+    if(counters)
+      counters->enable();
+    t0 = clock::now();
+    return {n, this};
+  }
+  iterator end() noexcept { return {0, nullptr}; }
+
+  std::uint64_t iterations() const noexcept { return n; }
+  /* 实际执行的迭代次数，循环被 break 提前结束时小于 iterations() */
+  std::uint64_t completed() const noexcept { return done; }
+  double elapsed_ns() const noexcept { return std::chrono::duration<double, std::nano>(t1 - t0).count(); }
+
+private:
+  /* left 不为 0 说明循环提前退出了，退出时所在的那次迭代也已经执行过 */
+  void finish(std::uint64_t left) {
+    t1 = clock::now();
+    if(counters)
+      counters->disable();
+    done = left == 0 ? n : n - left + 1;
+  }
+
+  std::uint64_t n;
+  std::uint64_t done = 0;
+  perf_counters *counters;
+  clock::time_point t0, t1;
+};
+
+using bench_fn = void (*)(state&);
+
+struct entry {
+  std::string name;
+  bench_fn fn;
+};
+
+inline std::vector<entry>& registry() {
+  static std::vector<entry> r;
+  return r;
+}
+
+struct registrar {
+  registrar(const char *name, bench_fn fn) { registry().push_back({name, fn}); }
+};
+
+/* ------------------------------ 统计与输出 ------------------------------ */
+struct result {
+  std::string name;
+  std::uint64_t iterations = 0;  // 每次采样的迭代次数
+  std::size_t samples = 0;
+  double median = 0, p10 = 0, p90 = 0, p99 = 0, min = 0, max = 0;  // 每次迭代的纳秒数
+  bool has_counters = false;
+  double counters[perf_counters::kEvents] = {};  // 每次迭代的事件数
+};
+
+/* 线性插值的百分位数，v 已经排好序 */
+inline double percentile(const std::vector<double> &v, double p) {
+  if(v.empty())
+    return 0;
+  double pos = p / 100 * static_cast<double>(v.size() - 1);
+  std::size_t lo = static_cast<std::size_t>(pos);
+  std::size_t hi = std::min(lo + 1, v.size() - 1);
+  return v[lo] + (v[hi] - v[lo]) * (pos - static_cast<double>(lo));
+}
+
+struct options {
+  std::string filter;
+  std::string json;
+  std::string baseline;
+  double min_time_ms = 300;
+  double warmup_ms = 50;
+  int samples = 21;
+  double threshold = 5;
+  bool counters = true;
+  bool list = false;
+};
+
+inline options parse_args(int argc, char **argv) {
+  options o;
+  for(int i = 1; i < argc; ++i) {
+    std::string a = argv[i];
+    auto value = [&a](const char *key) -> const char* {
+      std::size_t n = std::strlen(key);
+      return a.compare(0, n, key) == 0 ? a.c_str() + n : nullptr;
+    };
+    if(const char *v = value("--filter="))
+      o.filter = v;
+    else if(const char *v = value("--json="))
+      o.json = v;
+    else if(const char *v = value("--baseline="))
+      o.baseline = v;
+    else if(const char *v = value("--min-time="))
+      o.min_time_ms = std::atof(v);
+    else if(const char *v = value("--samples="))
+      o.samples = std::max(1, std::atoi(v));
+    else if(const char *v = value("--threshold="))
+      o.threshold = std::atof(v);
+    else if(a == "--no-counters")
+      o.counters = false;
+    else if(a == "--list")
+      o.list = true;
+    else
+      std::cerr << "unknown argument: " << a << "\n";
+  }
+  return o;
+}
+
+/* 一次采样：总耗时和实际执行的迭代次数 */
+struct sample {
+  double ns;
+  std::uint64_t iterations;
+};
+
+inline sample run_once(bench_fn fn, std::uint64_t n, perf_counters *counters) {
+  state st(n, counters);
+  fn(st);
+  return {st.elapsed_ns(), st.completed()};
+}
+
+inline result run_benchmark(const entry &e, const options &o, perf_counters *counters) {
+  const double sample_ns = o.min_time_ms * 1e6 / o.samples;
+
+  /* 倍增迭代次数，直到一次采样的时长达到目标 */
+  std::uint64_t n = 1;
+  for(;;) {
+    double t = run_once(e.fn, n, nullptr).ns;
+    if(t >= sample_ns || n >= (1ull << 40))
+      break;
+    double scale = t > 0 ? sample_ns / t * 1.2 : 100;
+    n = static_cast<std::uint64_t>(static_cast<double>(n) * std::min(100.0, std::max(2.0, scale)));
+  }
+
+  /* 预热：让缓存、分支预测器、CPU 频率稳定下来 */
+  auto warm_end = clock::now() + std::chrono::duration<double, std::milli>(o.warmup_ms);
+  do
+    run_once(e.fn, n, nullptr);
+  while(clock::now() < warm_end);
+
+  result r;
+  r.name = e.name;
+  r.iterations = n;
+  r.samples = static_cast<std::size_t>(o.samples);
+  if(counters)
+    counters->reset();
+  std::vector<double> per_iter;
+  std::uint64_t total = 0;
+  for(int s = 0; s < o.samples; ++s) {
+    sample one = run_once(e.fn, n, counters);
+    per_iter.push_back(one.ns / static_cast<double>(std::max<std::uint64_t>(one.iterations, 1)));
+    total += one.iterations;
+  }
+
+  std::sort(per_iter.begin(), per_iter.end());
+  r.median = percentile(per_iter, 50);
+  r.p10 = percentile(per_iter, 10);
+  r.p90 = percentile(per_iter, 90);
+  r.p99 = percentile(per_iter, 99);
+  r.min = per_iter.front();
+  r.max = per_iter.back();
+  if(counters && counters->read(r.counters)) {
+    r.has_counters = true;
+    for(double &c : r.counters)
+      c /= static_cast<double>(std::max<std::uint64_t>(total, 1));
+  }
+  return r;
+}
+
+inline std::string json_escape(const std::string &s) {
+  std::string out;
+  for(char c : s) {
+    if(c == '"' || c == '\\')
+      out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+inline void write_json(const std::string &path, const std::vector<result> &results) {
+  std::ofstream os(path);
+  os << "{\n  \"benchmarks\": [\n";
+  for(std::size_t i = 0; i < results.size(); ++i) {
+    const result &r = results[i];
+    os << "    {\"name\": \"" << json_escape(r.name) << "\", \"iterations\": " << r.iterations
+       << ", \"samples\": " << r.samples << ", \"median_ns\": " << r.median << ", \"p10_ns\": " << r.p10
+       << ", \"p90_ns\": " << r.p90 << ", \"p99_ns\": " << r.p99 << ", \"min_ns\": " << r.min
+       << ", \"max_ns\": " << r.max;
+    if(r.has_counters)
+      for(int k = 0; k < perf_counters::kEvents; ++k)
+        os << ", \"" << perf_counters::names[k] << "\": " << r.counters[k];
+    os << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  os << "  ]\n}\n";
+}
+
+/* 只读取 write_json 写出的格式：每个测试的 name 和 median_ns */
+inline std::map<std::string, double> read_baseline(const std::string &path) {
+  std::map<std::string, double> out;
+  std::ifstream is(path);
+  std::stringstream ss;
+  ss << is.rdbuf();
+  std::string text = ss.str();
+  const std::string name_key = "\"name\": \"", median_key = "\"median_ns\": ";
+  for(std::size_t pos = text.find(name_key); pos != std::string::npos; pos = text.find(name_key, pos)) {
+    pos += name_key.size();
+    std::string name;
+    for(; pos < text.size() && text[pos] != '"'; ++pos) {
+      if(text[pos] == '\\' && pos + 1 < text.size())
+        ++pos;
+      name += text[pos];
+    }
+    std::size_t m = text.find(median_key, pos);
+    if(m == std::string::npos)
+      break;
+    out[name] = std::strtod(text.c_str() + m + median_key.size(), nullptr);
+  }
+  return out;
+}
+
+inline void print_header(bool counters) {
+  std::cout << std::left << std::setw(44) << "benchmark" << std::right << std::setw(12) << "median ns"
+            << std::setw(10) << "p10" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(13) << "iters";
+  if(counters)
+    std::cout << std::setw(10) << "cycles" << std::setw(8) << "IPC" << std::setw(10) << "cache-m" << std::setw(10)
+              << "branch-m";
+  std::cout << "\n";
+}
+
+inline void print_result(const result &r) {
+  std::cout << std::left << std::setw(44) << r.name << std::right << std::fixed << std::setprecision(2)
+            << std::setw(12) << r.median << std::setw(10) << r.p10 << std::setw(10) << r.p90 << std::setw(10) << r.p99
+            << std::setw(13) << r.iterations;
+  if(r.has_counters)
+    std::cout << std::setw(10) << std::setprecision(1) << r.counters[0] << std::setw(8) << std::setprecision(2)
+              << (r.counters[0] > 0 ? r.counters[1] / r.counters[0] : 0.0) << std::setw(10) << std::setprecision(3)
+              << r.counters[2] << std::setw(10) << r.counters[3];
+  std::cout << "\n";
+  std::cout.unsetf(std::ios::fixed);
+}
+
+inline int run_benchmarks(int argc, char **argv) {
+  options o = parse_args(argc, argv);
+  std::vector<const entry*> selected;
+  for(const entry &e : registry())
+    if(e.name.find(o.filter) != std::string::npos)
+      selected.push_back(&e);
+  if(o.list) {
+    for(const entry *e : selected)
+      std::cout << e->name << "\n";
+    return 0;
+  }
+
+  std::unique_ptr<perf_counters> counters;
+  if(o.counters) {
+    counters = std::make_unique<perf_counters>();
+    if(!counters->available()) {
+      std::cout << "hardware counters unavailable (" << counters->unavailable_reason() << "), reporting time only\n";
+      counters.reset();
+    }
+  }
+
+  print_header(counters != nullptr);
+  std::vector<result> results;
+  for(const entry *e : selected) {
+    results.push_back(run_benchmark(*e, o, counters.get()));
+    print_result(results.back());
+  }
+
+  if(!o.json.empty()) {
+    write_json(o.json, results);
+    std::cout << "results written to " << o.json << "\n";
+  }
+
+  int regressions = 0;
+  if(!o.baseline.empty()) {
+    std::map<std::string, double> base = read_baseline(o.baseline);
+    if(base.empty())
+      std::cout << "baseline " << o.baseline << " is empty or unreadable\n";
+    else
+      std::cout << "\ncompared with " << o.baseline << " (threshold " << o.threshold << "%):\n";
+    for(const result &r : results) {
+      auto it = base.find(r.name);
+      if(it == base.end() || it->second <= 0)
+        continue;
+      double delta = (r.median - it->second) / it->second * 100;
+      const char *verdict = delta > o.threshold ? "REGRESSION" : delta < -o.threshold ? "improved" : "";
+      regressions += delta > o.threshold;
+      std::cout << "  " << std::left << std::setw(44) << r.name << std::right << std::fixed << std::setprecision(2)
+                << std::setw(10) << it->second << " -> " << std::setw(10) << r.median << std::showpos
+                << std::setw(9) << std::setprecision(1) << delta << "%" << std::noshowpos << "  " << verdict << "\n";
+      std::cout.unsetf(std::ios::fixed);
+    }
+  }
+  return regressions ? 1 : 0;
+}
+
+}  // namespace mb
+
+#define MB_CONCAT_(a, b) a##b
+#define MB_CONCAT(a, b) MB_CONCAT_(a, b)
+/* 第二个参数可以是函数名，也可以是不捕获的 lambda */
+#define BENCHMARK(name, ...) static ::mb::registrar MB_CONCAT(mb_registrar_, __LINE__)(name, __VA_ARGS__)
+#define MB_MAIN() \
+  int main(int argc, char **argv) { return ::mb::run_benchmarks(argc, argv); }
+
+#endif  // MICROBENCH_H
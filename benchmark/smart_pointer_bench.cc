@@ -0,0 +1,367 @@
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "microbench.h"
+#include "../smart_pointer/cycle_collector.h"
+#include "../smart_pointer/fast_pimpl.h"
+#include "../smart_pointer/pool_allocator.h"
+#include "../smart_pointer/rcu_snapshot.h"
+#include "../smart_pointer/slot_map.h"
+
+/**
+ * @brief smart_pointer/ 下各个示例对应的基准测试
+ * shared_ptr.cc、unique_ptr.cc、weak_ptr.cc 测量示例中的操作本身；
+ * atomic_shared_ptr.cc、cycle_collector.cc、fast_pimpl.cc、pool_allocator.cc、slot_map.cc 的组件在同名（或 rcu_snapshot.h）
+ * 头文件中，这里直接测量组件本身，旁边放一条它要替换的标准库写法（名字带 std_），回归比较看的是组件那一条
+ * 编译：g++ -std=c++17 -O2 -pthread benchmark/smart_pointer_bench.cc -o smart_pointer_bench
+ */
+
+struct Foo {
+  int value = 0;
+  void foo() { ++value; }
+};
+
+/* ---- unique_ptr.cc ---- */
+BENCHMARK("unique_ptr/make_unique_and_destroy", [](mb::state &st) {
+  for(auto _ : st) {
+    auto p = std::make_unique<Foo>();
+    mb::do_not_optimize(p.get());
+  }
+});
+
+BENCHMARK("unique_ptr/raw_new_delete", [](mb::state &st) {
+  for(auto _ : st) {
+    Foo *p = new Foo;
+    mb::do_not_optimize(p);
+    delete p;
+  }
+});
+
+BENCHMARK("unique_ptr/move_back_and_forth", [](mb::state &st) {
+  auto p1 = std::make_unique<Foo>();
+  for(auto _ : st) {
+    std::unique_ptr<Foo> p2 = std::move(p1);
+    p2->foo();
+    p1 = std::move(p2);
+    mb::do_not_optimize(p1);
+  }
+});
+
+/* ---- shared_ptr.cc ---- */
+BENCHMARK("shared_ptr/make_shared", [](mb::state &st) {
+  for(auto _ : st) {
+    auto p = std::make_shared<int>(10);
+    mb::do_not_optimize(p.get());
+  }
+});
+
+BENCHMARK("shared_ptr/shared_ptr_new", [](mb::state &st) {
+  for(auto _ : st) {
+    std::shared_ptr<int> p(new int(10));
+    mb::do_not_optimize(p.get());
+  }
+});
+
+/* 按值传参：一次原子加一次原子减 */
+__attribute__((noinline)) void foo(std::shared_ptr<int> i) { (*i)++; }
+__attribute__((noinline)) void foo_ref(const std::shared_ptr<int> &i) { (*i)++; }
+
+BENCHMARK("shared_ptr/pass_by_value", [](mb::state &st) {
+  auto p = std::make_shared<int>(10);
+  for(auto _ : st)
+    foo(p);
+  mb::do_not_optimize(*p);
+});
+
+BENCHMARK("shared_ptr/pass_by_const_ref", [](mb::state &st) {
+  auto p = std::make_shared<int>(10);
+  for(auto _ : st)
+    foo_ref(p);
+  mb::do_not_optimize(*p);
+});
+
+/* ---- weak_ptr.cc ---- */
+BENCHMARK("weak_ptr/lock_alive", [](mb::state &st) {
+  auto sp = std::make_shared<int>(10);
+  std::weak_ptr<int> wp = sp;
+  int sum = 0;
+  for(auto _ : st)
+    if(auto p = wp.lock())
+      sum += *p;
+  mb::do_not_optimize(sum);
+});
+
+BENCHMARK("weak_ptr/expired", [](mb::state &st) {
+  auto sp = std::make_shared<int>(10);
+  std::weak_ptr<int> wp = sp;
+  int alive = 0;
+  for(auto _ : st) {
+    mb::do_not_optimize(wp);
+    alive += !wp.expired();
+  }
+  mb::do_not_optimize(alive);
+});
+
+/* ---- atomic_shared_ptr.cc：rcu_snapshot 的读取和发布，对照 std::atomic_load ---- */
+BENCHMARK("atomic_shared_ptr/std_atomic_load", [](mb::state &st) {
+  auto config = std::make_shared<std::string>("timeout=30");
+  std::size_t n = 0;
+  for(auto _ : st) {
+    std::shared_ptr<std::string> snapshot = std::atomic_load(&config);
+    n += snapshot->size();
+  }
+  mb::do_not_optimize(n);
+});
+
+BENCHMARK("atomic_shared_ptr/rcu_snapshot_read", [](mb::state &st) {
+  rcu_snapshot<std::string> config(std::make_unique<std::string>("timeout=30"));
+  std::size_t n = 0;
+  for(auto _ : st)
+    n += config.read()->size();
+  mb::do_not_optimize(n);
+});
+
+/* 发布一次新值，没有读者时旧值立即回收 */
+BENCHMARK("atomic_shared_ptr/rcu_snapshot_store", [](mb::state &st) {
+  rcu_snapshot<std::string> config(std::make_unique<std::string>("timeout=30"));
+  for(auto _ : st)
+    config.store(std::make_unique<std::string>("timeout=60"));
+  config.synchronize();
+});
+
+/* ---- cycle_collector.cc：A、B 成环后离开作用域，由 collect() 回收；对照用 weak_ptr 手工打破的环 ---- */
+struct B;
+struct A {
+  std::shared_ptr<B> pointer;
+};
+struct B {
+  std::weak_ptr<A> pointer;
+};
+
+BENCHMARK("cycle_collector/std_shared_weak_pair", [](mb::state &st) {
+  for(auto _ : st) {
+    auto a = std::make_shared<A>();
+    auto b = std::make_shared<B>();
+    a->pointer = b;
+    b->pointer = a;
+    mb::do_not_optimize(a.get());
+  }
+});
+
+struct TB;
+struct TA {
+  tracked_ptr<TB> pointer;
+};
+struct TB {
+  tracked_ptr<TA> pointer;
+};
+
+BENCHMARK("cycle_collector/tracked_cycle_collect", [](mb::state &st) {
+  auto &heap = gc_heap::instance();
+  std::size_t freed = 0;
+  for(auto _ : st) {
+    {
+      auto a = make_tracked(TA);
+      auto b = make_tracked(TB);
+      a->pointer = b;
+      b->pointer = a;
+    }
+    freed += heap.collect();
+  }
+  mb::do_not_optimize(freed);
+});
+
+BENCHMARK("cycle_collector/tracked_ptr_copy", [](mb::state &st) {
+  auto a = make_tracked(TA);
+  for(auto _ : st) {
+    auto copy = a;
+    mb::do_not_optimize(copy);
+  }
+  a.reset();
+  gc_heap::instance().collect();
+});
+
+/* ---- fast_pimpl.cc：同一个 widget 分别用 unique_ptr 和 fast_pimpl 持有实现，构造并访问一次 ---- */
+struct widget_impl {
+  std::string name = "widget";
+  int counter = 0;
+};
+
+struct heap_widget {
+  heap_widget() : impl(std::make_unique<widget_impl>()) {}
+  int bump() { return ++impl->counter; }
+  std::unique_ptr<widget_impl> impl;
+};
+
+struct fast_widget {
+  int bump() { return ++impl->counter; }
+  fast_pimpl<widget_impl, 48, 8> impl;
+};
+
+BENCHMARK("fast_pimpl/std_unique_ptr_pimpl", [](mb::state &st) {
+  int sum = 0;
+  for(auto _ : st) {
+    heap_widget w;
+    sum += w.bump();
+  }
+  mb::do_not_optimize(sum);
+});
+
+BENCHMARK("fast_pimpl/fast_pimpl", [](mb::state &st) {
+  int sum = 0;
+  for(auto _ : st) {
+    fast_widget w;
+    sum += w.bump();
+  }
+  mb::do_not_optimize(sum);
+});
+
+/* ---- pool_allocator.cc：64 个存活的 32 字节对象轮流释放、重新分配 ---- */
+struct node {
+  std::uint64_t key;
+  node *next;
+  char payload[16];
+};
+
+BENCHMARK("pool_allocator/std_new_delete_32b", [](mb::state &st) {
+  std::vector<node*> live(64);
+  std::size_t i = 0;
+  for(auto _ : st) {
+    delete live[i];
+    live[i] = new node{};
+    i = (i + 1) & 63;
+  }
+  for(node *p : live)
+    delete p;
+});
+
+BENCHMARK("pool_allocator/std_pmr_pool_32b", [](mb::state &st) {
+  std::pmr::unsynchronized_pool_resource pool;
+  std::pmr::polymorphic_allocator<node> alloc(&pool);
+  std::vector<node*> live(64, nullptr);
+  std::size_t i = 0;
+  for(auto _ : st) {
+    if(live[i])
+      alloc.deallocate(live[i], 1);
+    live[i] = alloc.allocate(1);
+    mb::do_not_optimize(live[i]);
+    i = (i + 1) & 63;
+  }
+  for(node *p : live)
+    if(p)
+      alloc.deallocate(p, 1);
+});
+
+BENCHMARK("pool_allocator/slab_pool_32b", [](mb::state &st) {
+  auto &pool = SlabPool::instance();
+  std::vector<void*> live(64, nullptr);
+  std::size_t i = 0;
+  for(auto _ : st) {
+    pool.deallocate(live[i], sizeof(node));
+    live[i] = pool.allocate(sizeof(node));
+    mb::do_not_optimize(live[i]);
+    i = (i + 1) & 63;
+  }
+  for(void *p : live)
+    pool.deallocate(p, sizeof(node));
+});
+
+BENCHMARK("pool_allocator/pool_make_unique", [](mb::state &st) {
+  std::vector<pool_unique_ptr<node>> live(64);
+  std::size_t i = 0;
+  for(auto _ : st) {
+    live[i] = pool_make_unique<node>();
+    mb::do_not_optimize(live[i].get());
+    i = (i + 1) & 63;
+  }
+});
+
+BENCHMARK("pool_allocator/std_make_shared", [](mb::state &st) {
+  std::vector<std::shared_ptr<node>> live(64);
+  std::size_t i = 0;
+  for(auto _ : st) {
+    live[i] = std::make_shared<node>();
+    mb::do_not_optimize(live[i].get());
+    i = (i + 1) & 63;
+  }
+});
+
+BENCHMARK("pool_allocator/allocate_shared", [](mb::state &st) {
+  std::vector<std::shared_ptr<node>> live(64);
+  std::size_t i = 0;
+  for(auto _ : st) {
+    live[i] = std::allocate_shared<node>(PoolAllocator<node>());
+    mb::do_not_optimize(live[i].get());
+    i = (i + 1) & 63;
+  }
+});
+
+BENCHMARK("pool_allocator/slab_resource_pmr_vector", [](mb::state &st) {
+  SlabResource res;
+  for(auto _ : st) {
+    std::pmr::vector<int> v(&res);
+    for(int i = 0; i < 16; ++i)
+      v.push_back(i);
+    mb::do_not_optimize(v.data());
+  }
+});
+
+/* ---- slot_map.cc：4096 个对象中随机查找；对照通过 weak_ptr 句柄访问 ---- */
+BENCHMARK("slot_map/std_weak_ptr_lock", [](mb::state &st) {
+  std::vector<std::shared_ptr<int>> owners;
+  std::vector<std::weak_ptr<int>> handles;
+  for(int i = 0; i < 4096; ++i) {
+    owners.push_back(std::make_shared<int>(i));
+    handles.push_back(owners.back());
+  }
+  std::uint32_t x = 2463534242u;
+  long sum = 0;
+  for(auto _ : st) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    if(auto p = handles[x & 4095].lock())
+      sum += *p;
+  }
+  mb::do_not_optimize(sum);
+});
+
+BENCHMARK("slot_map/get", [](mb::state &st) {
+  slot_map<int> objects;
+  std::vector<slot_handle> handles;
+  for(int i = 0; i < 4096; ++i)
+    handles.push_back(objects.emplace(i));
+  std::uint32_t x = 2463534242u;
+  long sum = 0;
+  for(auto _ : st) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    if(int *p = objects.get(handles[x & 4095]))
+      sum += *p;
+  }
+  mb::do_not_optimize(sum);
+});
+
+/* 删除一个随机对象再插入一个，槽位从空闲链表中复用 */
+BENCHMARK("slot_map/erase_emplace", [](mb::state &st) {
+  slot_map<int> objects;
+  std::vector<slot_handle> handles;
+  for(int i = 0; i < 4096; ++i)
+    handles.push_back(objects.emplace(i));
+  std::uint32_t x = 2463534242u;
+  for(auto _ : st) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    slot_handle &h = handles[x & 4095];
+    objects.erase(h);
+    h = objects.emplace(static_cast<int>(x));
+  }
+  mb::do_not_optimize(objects.size());
+});
+
+MB_MAIN()
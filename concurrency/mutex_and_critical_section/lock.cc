@@ -1,6 +1,8 @@
 #include <iostream>
+#include <mutex>
 #include <thread>
 #include <chrono>
+#include "../practice/trace.h"
 
 int v = 1;
 
@@ -11,12 +13,18 @@ int v = 1;
  * 这是一个非常强的同步条件
  */
 
+/**
+ * @brief 加上 -DTRACE_ENABLED 编译会把等锁和临界区记录下来，结束时写出 lock.json，
+ * 用 chrome://tracing 打开可以看到两个线程在锁上的交错（见 concurrency/practice/trace.h）
+ */
+
 /**
  * @brief std::lock_guard 可以在栈上对象被销毁的时候自动释放锁
  * std::lock_guard 不能显式调用 lock 和 unlock
  */
 void critical_section_use_lock_guard(int change_v) {
   static std::mutex mtx;
+  TRACE_SCOPE("lock_guard");
   std::lock_guard<std::mutex> lock(mtx);
   v = change_v; // 临界区操作
 
@@ -33,17 +41,28 @@ void critical_section_use_unique_lock(int change_v) {
   static std::mutex mtx_1;
   
   /* 第一组临界区 */
-  std::unique_lock<std::mutex> lock(mtx_1);
-  v = change_v;
-  std::cout << "thread id: " << std::this_thread::get_id() << ", v = " << v << "\n";
-  lock.unlock();
+  std::unique_lock<std::mutex> lock(mtx_1, std::defer_lock);
+  {
+    TRACE_SCOPE("wait lock");
+    lock.lock();
+  }
+  {
+    TRACE_SCOPE("critical section 1");
+    v = change_v;
+    std::cout << "thread id: " << std::this_thread::get_id() << ", v = " << v << "\n";
+    lock.unlock();
+  }
 
   /* 在此期间任何人都可以抢夺 v 的持有权 */
   using namespace std::chrono_literals;
   std::this_thread::sleep_for(1000ms);
 
   /* 第二组临界区 */
-  lock.lock();
+  {
+    TRACE_SCOPE("wait lock");
+    lock.lock();
+  }
+  TRACE_SCOPE("critical section 2");
   v += 1;
   std::cout << "thread id: " << std::this_thread::get_id() << ", v = " << v << "\n";
 
@@ -64,4 +83,5 @@ int main() {
   t3.join();
   t4.join();
   std::cout << v << "\n";
+  TRACE_DUMP("lock.json");
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "async_logger.h"
+
+/**
+ * @brief async_logger.h 的使用：condition_variable.cc 中的生产者、消费者改用 ALOG，以及和同步写 std::cout 的调用者延迟对比
+ */
+
+/* ------------------------------ 延迟测试 ------------------------------ */
+using clock_type = std::chrono::steady_clock;
+
+/* 两条日志之间做一点别的事情，模拟真实的业务线程 */
+inline void do_work() {
+  for(int k = 0; k < 200; ++k)
+    asm volatile("");
+}
+
+/* max 主要取决于调度：线程数多于 CPU 核数时，调用者可能恰好在日志调用中被切换出去 */
+template<typename Log>
+std::string measure(const char *name, int threads, int per_thread, Log log_one) {
+  std::vector<std::vector<std::uint32_t>> lat(threads);
+  std::vector<std::thread> vt;
+  for(int t = 0; t < threads; ++t) {
+    vt.emplace_back([&, t] {
+      auto &l = lat[t];
+      l.reserve(per_thread);
+      for(int i = 0; i < per_thread; ++i) {
+        auto t0 = clock_type::now();
+        log_one(i);
+        auto t1 = clock_type::now();
+        l.push_back(static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+        do_work();
+      }
+    });
+  }
+  for(auto &t : vt)
+    t.join();
+
+  std::vector<std::uint32_t> all;
+  for(auto &l : lat)
+    all.insert(all.end(), l.begin(), l.end());
+  std::sort(all.begin(), all.end());
+  auto pct = [&](double p) { return all[static_cast<std::size_t>(p * (all.size() - 1))]; };
+  return "  " + std::string(name) + ": p50 " + std::to_string(pct(0.5)) + " ns, p99 " + std::to_string(pct(0.99)) +
+         " ns, p999 " + std::to_string(pct(0.999)) + " ns, max " + std::to_string(all.back()) + " ns\n";
+}
+
+int main() {
+  /* condition_variable.cc 中的生产者、消费者，日志写到标准输出 */
+  {
+    auto &log = alog::logger::instance();
+    log.start(STDOUT_FILENO);
+    std::thread producer([] {
+      for(int i = 0; i < 3; ++i)
+        ALOG("producing {}", i);
+    });
+    std::thread consumer([] {
+      for(int i = 0; i < 3; ++i)
+        ALOG("consuming {} from {}, ok = {}", i, std::string("queue"), true);
+    });
+    producer.join();
+    consumer.join();
+    ALOG("done");
+    log.flush();
+    log.stop();
+  }
+
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 200000;
+  std::cout << kThreads << " threads x " << kPerThread << " messages, output to /dev/null, caller-side latency:\n";
+
+  /* 同步输出：整行在锁内写入 std::cout 并 flush */
+  {
+    std::filebuf null_buf;
+    null_buf.open("/dev/null", std::ios::out);
+    std::streambuf *old = std::cout.rdbuf(&null_buf);
+    std::mutex cout_mtx;
+    auto t0 = clock_type::now();
+    std::string result = measure("std::cout (sync)    ", kThreads, kPerThread, [&](int i) {
+      std::lock_guard<std::mutex> lock(cout_mtx);
+      std::cout << "producing " << i << " value " << i * 0.5 << " from " << "worker" << std::endl;
+    });
+    auto t1 = clock_type::now();
+    std::cout.rdbuf(old);
+    std::cout << result << "    total " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms\n";
+  }
+
+  /* 异步日志 */
+  int null_fd = ::open("/dev/null", O_WRONLY);
+  for(auto policy : {alog::overflow::block, alog::overflow::drop}) {
+    auto &log = alog::logger::instance();
+    log.start(null_fd, policy);
+    std::uint64_t written_before = log.written(), dropped_before = log.dropped();
+    auto t0 = clock_type::now();
+    std::cout << measure(policy == alog::overflow::block ? "alog (block)        " : "alog (drop)         ", kThreads, kPerThread,
+            [](int i) { ALOG("producing {} value {} from {}", i, i * 0.5, "worker"); });
+    log.flush();
+    auto t1 = clock_type::now();
+    log.stop();
+    std::cout << "    total " << std::chrono::duration<double, std::milli>(t1 - t0).count() << " ms including drain, "
+              << log.written() - written_before << " written, " << log.dropped() - dropped_before << " dropped\n";
+  }
+
+  /* 缓冲区很小、生产者不停地写时 drop 策略丢弃的条数 */
+  {
+    auto &log = alog::logger::instance();
+    log.start(null_fd, alog::overflow::drop, 4096);
+    std::uint64_t written_before = log.written(), dropped_before = log.dropped();
+    std::thread burst([] {
+      for(int i = 0; i < 100000; ++i)
+        ALOG("burst {}", i);
+    });
+    burst.join();
+    log.flush();
+    log.stop();
+    std::cout << "  4 KiB ring, burst of 100000 with drop policy: " << log.written() - written_before << " written, "
+              << log.dropped() - dropped_before << " dropped\n";
+  }
+
+  /* 重复 start() 被忽略；stop() 之后没有后台线程，block 策略写满缓冲区也不会卡住 */
+  {
+    auto &log = alog::logger::instance();
+    bool first = log.start(null_fd), second = log.start(null_fd);
+    log.stop();
+    std::thread late([] {
+      for(int i = 0; i < 100000; ++i)
+        ALOG("after stop {}", i);
+    });
+    late.join();
+    std::cout << std::boolalpha << "  start twice: " << first << ", " << second
+              << "; 100000 messages after stop() returned without blocking\n";
+  }
+  ::close(null_fd);
+}
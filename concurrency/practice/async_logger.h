@@ -0,0 +1,464 @@
+#ifndef ASYNC_LOGGER_H
+#define ASYNC_LOGGER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * @brief 异步日志
+ * concurrency/ 下的例子都在工作线程里直接写 std::cout（例如 condition_variable.cc 中的 "producing"/"consuming"），
+ * 所有线程在流的锁上排队，I/O 的延迟也落在了调用者身上
+ *
+ * 这里的 ALOG("producing {}", i)：
+ * 1. 调用线程只把一条二进制记录写进自己的 SPSC 环形缓冲区：调用点（格式串、文件、行号）的指针、解码函数的指针、
+ *    时间戳和原始的参数字节，字符串参数按长度加内容拷贝进去，不做任何格式化
+ * 2. 每个线程第一次写日志时注册一个环形缓冲区，线程退出后缓冲区由后台线程排空再回收
+ * 3. 后台线程轮询所有缓冲区，在自己的线程里解码、格式化，攒成一大块之后一次 write()
+ * 4. 缓冲区满时的策略：overflow::drop 丢弃这一条并计数，overflow::block 自旋等待后台线程腾出空间；
+ *    后台线程没有运行（start() 之前、stop() 之后）时没有人会腾出空间，block 也退化为丢弃
+ * 5. start() / stop() 互斥执行，可以和写日志的线程并发调用；它们修改的配置都是原子变量
+ *
+ * 同一个线程的日志保持顺序，不同线程之间的日志不保证按时间排序，每一行带有时间戳和线程编号
+ */
+namespace alog {
+
+enum class overflow { drop, block };
+
+/* ------------------------------ 参数的编码 ------------------------------ */
+
+/* 后台线程解码出来的参数，字符串指向环形缓冲区中的记录 */
+struct arg_value {
+  enum kind_t : unsigned char { i64, u64, f64, boolean, character, string } kind;
+  union {
+    long long i;
+    unsigned long long u;
+    double d;
+    bool b;
+    char c;
+  };
+  std::string_view s;
+};
+
+template<typename T>
+constexpr bool is_string_arg = std::is_same<T, const char*>::value ||
+                               std::is_same<T, std::string>::value || std::is_same<T, std::string_view>::value;
+
+/* 字符串字面量和 char* 都按 const char* 处理 */
+template<typename T>
+using arg_t = std::conditional_t<std::is_same<std::decay_t<T>, char*>::value, const char*, std::decay_t<T>>;
+
+template<typename T>
+std::size_t encoded_size(const T &v) {
+  if constexpr(is_string_arg<T>)
+    return sizeof(std::uint32_t) + std::string_view(v).size();
+  else
+    return sizeof(T);
+}
+
+template<typename T>
+char* encode(char *p, const T &v) {
+  static_assert(is_string_arg<T> || std::is_arithmetic<T>::value, "unsupported log argument type");
+  if constexpr(is_string_arg<T>) {
+    std::string_view s(v);
+    std::uint32_t n = static_cast<std::uint32_t>(s.size());
+    std::memcpy(p, &n, sizeof(n));
+    std::memcpy(p + sizeof(n), s.data(), n);
+    return p + sizeof(n) + n;
+  } else {
+    std::memcpy(p, &v, sizeof(T));
+    return p + sizeof(T);
+  }
+}
+
+template<typename T>
+const char* decode_one(const char *p, arg_value &out) {
+  if constexpr(is_string_arg<T>) {
+    std::uint32_t n;
+    std::memcpy(&n, p, sizeof(n));
+    out.kind = arg_value::string;
+    out.s = std::string_view(p + sizeof(n), n);
+    return p + sizeof(n) + n;
+  } else {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    if constexpr(std::is_same<T, bool>::value) {
+      out.kind = arg_value::boolean;
+      out.b = v;
+    } else if constexpr(std::is_same<T, char>::value) {
+      out.kind = arg_value::character;
+      out.c = v;
+    } else if constexpr(std::is_floating_point<T>::value) {
+      out.kind = arg_value::f64;
+      out.d = v;
+    } else if constexpr(std::is_signed<T>::value) {
+      out.kind = arg_value::i64;
+      out.i = v;
+    } else {
+      out.kind = arg_value::u64;
+      out.u = v;
+    }
+    return p + sizeof(T);
+  }
+}
+
+/* 一条日志最多的参数个数，后台线程按这个大小准备解码缓冲区 */
+constexpr std::uint32_t kMaxArgs = 16;
+
+/* 每个参数型别列表对应一个解码函数，指针随记录一起写入 */
+using decode_fn = void (*)(const char *payload, arg_value *out);
+
+template<typename... Args>
+void decode(const char *p, arg_value *out) {
+  std::size_t i = 0;
+  ((p = decode_one<Args>(p, out[i++])), ...);
+  (void)p;
+  (void)i;
+}
+
+/* 调用点的信息是静态的，记录中只保存它的地址 */
+struct log_site {
+  const char *fmt;
+  const char *file;
+  int line;
+};
+
+struct record_header {
+  const log_site *site;  // nullptr 表示回绕时的填充
+  decode_fn decoder;
+  std::uint64_t ts;      // steady_clock 的纳秒数
+  std::uint32_t size;    // 包括记录头，按 8 字节对齐
+  std::uint32_t nargs;
+};
+
+/* ------------------------------ SPSC 环形缓冲区 ------------------------------ */
+
+/**
+ * head 和 tail 都是单调递增的字节序号，对容量取模得到位置
+ * 一条记录总是连续存放，放不下时在末尾写一个填充记录（或者剩余空间连记录头都放不下）然后从头开始
+ */
+class spsc_ring {
+public:
+  spsc_ring(std::size_t capacity, unsigned id)
+      : cap(capacity), mask(capacity - 1), buf(new std::uint64_t[capacity / 8]()), thread_id(id) {}
+
+  /* 生产者：预留 n 字节，失败返回 nullptr */
+  char* try_reserve(std::size_t n) {
+    std::size_t h = head.load(std::memory_order_relaxed);
+    std::size_t pos = h & mask;
+    std::size_t waste = pos + n > cap ? cap - pos : 0;
+    if(h + waste + n - cached_tail > cap) {
+      cached_tail = tail.load(std::memory_order_acquire);
+      if(h + waste + n - cached_tail > cap)
+        return nullptr;
+    }
+    if(waste >= sizeof(record_header))
+      reinterpret_cast<record_header*>(bytes() + pos)->site = nullptr;
+    pending_waste = waste;
+    return bytes() + ((h + waste) & mask);
+  }
+
+  void commit(std::size_t n) {
+    head.store(head.load(std::memory_order_relaxed) + pending_waste + n, std::memory_order_release);
+  }
+
+  /* 消费者：依次处理已经提交的记录，返回处理的条数 */
+  template<typename F>
+  std::size_t consume(F f) {
+    std::size_t t = tail.load(std::memory_order_relaxed);
+    std::size_t h = head.load(std::memory_order_acquire);
+    std::size_t n = 0;
+    while(t != h) {
+      std::size_t pos = t & mask;
+      auto *rec = reinterpret_cast<const record_header*>(bytes() + pos);
+      if(cap - pos < sizeof(record_header) || rec->site == nullptr) {
+        t += cap - pos;
+        continue;
+      }
+      f(*rec, reinterpret_cast<const char*>(rec + 1));
+      t += rec->size;
+      ++n;
+    }
+    tail.store(t, std::memory_order_release);
+    return n;
+  }
+
+  bool empty() const {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+
+  std::atomic<bool> retired{false};
+  std::atomic<std::uint64_t> dropped{0};
+  const std::size_t cap;
+
+private:
+  char* bytes() { return reinterpret_cast<char*>(buf.get()); }
+
+  const std::size_t mask;
+  std::unique_ptr<std::uint64_t[]> buf;  // 保证记录头按 8 字节对齐；值初始化会提前触发缺页，不让第一圈写入承担
+
+public:
+  const unsigned thread_id;
+
+private:
+  alignas(64) std::atomic<std::size_t> head{0};  // 生产者写
+  std::size_t cached_tail = 0;                   // 生产者缓存的 tail，减少对消费者缓存行的访问
+  std::size_t pending_waste = 0;
+  alignas(64) std::atomic<std::size_t> tail{0};  // 消费者写
+};
+
+/* ------------------------------ 日志器 ------------------------------ */
+class logger {
+public:
+  static logger& instance() {
+    static logger l;
+    return l;
+  }
+
+  /**
+   * ring_bytes 向上取整为 2 的幂（至少 4 KiB），只影响之后新注册的线程
+   * 已经在运行时不做任何事情并返回 false
+   */
+  bool start(int out_fd, overflow p = overflow::block, std::size_t ring_bytes = 1 << 20) {
+    std::lock_guard<std::mutex> lock(control);
+    if(running.load())
+      return false;
+    std::size_t size = 4096;
+    while(size < ring_bytes)
+      size <<= 1;
+    fd.store(out_fd, std::memory_order_relaxed);
+    policy.store(p, std::memory_order_relaxed);
+    ring_size.store(size, std::memory_order_relaxed);
+    epoch_ns.store(now_ns(), std::memory_order_relaxed);
+    running.store(true, std::memory_order_release);
+    backend = std::thread([this] { backend_loop(); });
+    return true;
+  }
+
+  /* 排空所有缓冲区后停止后台线程 */
+  void stop() {
+    std::lock_guard<std::mutex> lock(control);
+    if(!running.exchange(false))
+      return;
+    backend.join();
+  }
+
+  /* 等待所有已经写入的记录被输出；后台线程没有运行时直接返回 */
+  void flush() {
+    while(running.load()) {
+      bool all_empty = true;
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        for(auto &r : rings)
+          all_empty = all_empty && r->empty();
+      }
+      if(all_empty && pending_output.load(std::memory_order_acquire) == 0)
+        return;
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+  std::uint64_t dropped() const { return total_dropped.load(); }
+  std::uint64_t written() const { return total_written.load(); }
+
+  template<typename... Args>
+  void log(const log_site &site, const Args&... args) {
+    static_assert(sizeof...(Args) <= kMaxArgs, "too many log arguments");
+    spsc_ring &ring = local_ring();
+    std::size_t n = sizeof(record_header) + (std::size_t{0} + ... + encoded_size<arg_t<Args>>(args));
+    n = (n + 7) & ~std::size_t{7};
+
+    char *p = ring.try_reserve(n);
+    while(p == nullptr) {
+      if(policy.load(std::memory_order_relaxed) == overflow::drop || n > ring.cap / 2 || !running.load()) {
+        ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+      }
+      std::this_thread::yield();
+      p = ring.try_reserve(n);
+    }
+
+    auto *rec = reinterpret_cast<record_header*>(p);
+    rec->site = &site;
+    rec->decoder = &decode<arg_t<Args>...>;
+    /* start() 之前写入的记录时间戳记为 0 */
+    std::int64_t ts = now_ns() - epoch_ns.load(std::memory_order_relaxed);
+    rec->ts = ts > 0 ? static_cast<std::uint64_t>(ts) : 0;
+    rec->size = static_cast<std::uint32_t>(n);
+    rec->nargs = sizeof...(Args);
+    char *q = p + sizeof(record_header);
+    ((q = encode<arg_t<Args>>(q, args)), ...);
+    (void)q;
+    ring.commit(n);
+  }
+
+  ~logger() { stop(); }
+
+private:
+  logger() = default;
+
+  static std::int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  /* 线程退出时把缓冲区标记为退役，由后台线程排空后删除 */
+  struct ring_holder {
+    std::shared_ptr<spsc_ring> ring;
+    ~ring_holder() {
+      if(ring)
+        ring->retired = true;
+    }
+  };
+
+  spsc_ring& local_ring() {
+    thread_local ring_holder holder;
+    if(!holder.ring) {
+      std::lock_guard<std::mutex> lock(mtx);
+      holder.ring = std::make_shared<spsc_ring>(ring_size.load(std::memory_order_relaxed), next_thread_id++);
+      rings.push_back(holder.ring);
+    }
+    return *holder.ring;
+  }
+
+  void backend_loop() {
+    std::string out;
+    out.reserve(1 << 16);
+    std::vector<std::shared_ptr<spsc_ring>> snapshot;
+    for(;;) {
+      bool stopping = !running.load();
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        snapshot = rings;
+      }
+      pending_output = 1;
+      std::size_t n = 0;
+      for(auto &r : snapshot) {
+        bool retired = r->retired.load();
+        n += r->consume([&](const record_header &rec, const char *payload) {
+          format_record(out, *r, rec, payload);
+          if(out.size() >= (1 << 16))
+            write_out(out);
+        });
+        total_dropped += r->dropped.exchange(0);
+        if(retired && r->empty()) {
+          std::lock_guard<std::mutex> lock(mtx);
+          rings.erase(std::find(rings.begin(), rings.end(), r));
+        }
+      }
+      write_out(out);
+      total_written += n;
+      pending_output = 0;
+      if(n == 0) {
+        if(stopping)
+          return;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+  }
+
+  template<typename T>
+  static void append_number(std::string &out, T v) {
+    char buf[32];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v);
+    out.append(buf, r.ptr - buf);
+  }
+
+  static void append_arg(std::string &out, const arg_value &a) {
+    switch(a.kind) {
+      case arg_value::i64: append_number(out, a.i); break;
+      case arg_value::u64: append_number(out, a.u); break;
+      case arg_value::f64: append_number(out, a.d); break;
+      case arg_value::boolean: out += a.b ? "true" : "false"; break;
+      case arg_value::character: out += a.c; break;
+      case arg_value::string: out += a.s; break;
+    }
+  }
+
+  /* 格式化在后台线程中进行，格式串在这里才被解析 */
+  static void format_record(std::string &out, const spsc_ring &ring, const record_header &rec, const char *payload) {
+    arg_value args[kMaxArgs];
+    rec.decoder(payload, args);
+
+    /* [秒.微秒] [T线程编号] */
+    char prefix[48];
+    char *p = prefix;
+    *p++ = '[';
+    p = std::to_chars(p, prefix + sizeof(prefix), rec.ts / 1000000000).ptr;
+    *p++ = '.';
+    std::uint64_t us = rec.ts / 1000 % 1000000;
+    for(std::uint64_t d = 100000; d > 0; d /= 10)
+      *p++ = static_cast<char>('0' + us / d % 10);
+    p = std::copy_n("] [T", 4, p);
+    p = std::to_chars(p, prefix + sizeof(prefix), ring.thread_id).ptr;
+    p = std::copy_n("] ", 2, p);
+    out.append(prefix, p - prefix);
+
+    std::uint32_t next = 0;
+    for(const char *f = rec.site->fmt; *f; ++f) {
+      if(f[0] == '{' && f[1] == '}' && next < rec.nargs) {
+        append_arg(out, args[next++]);
+        ++f;
+      } else {
+        out += *f;
+      }
+    }
+    out += '\n';
+  }
+
+  void write_out(std::string &out) {
+    const char *p = out.data();
+    std::size_t n = out.size();
+    while(n > 0) {
+      ssize_t w = ::write(fd.load(std::memory_order_relaxed), p, n);
+      if(w < 0) {
+        if(errno == EINTR)
+          continue;
+        break;
+      }
+      p += w;
+      n -= static_cast<std::size_t>(w);
+    }
+    out.clear();
+  }
+
+  /* 由 start() 在 control 锁内写入，写日志的线程随时可能读取 */
+  std::mutex control;
+  std::atomic<int> fd{STDOUT_FILENO};
+  std::atomic<overflow> policy{overflow::block};
+  std::atomic<std::size_t> ring_size{1 << 20};
+  std::atomic<std::int64_t> epoch_ns{0};
+
+  std::mutex mtx;
+  std::vector<std::shared_ptr<spsc_ring>> rings;
+  unsigned next_thread_id = 0;
+
+  std::thread backend;
+  std::atomic<bool> running{false};
+  std::atomic<int> pending_output{0};
+  std::atomic<std::uint64_t> total_dropped{0};
+  std::atomic<std::uint64_t> total_written{0};
+};
+
+}  // namespace alog
+
+/* 调用点信息放在静态存储中，只有参数会被拷贝 */
+#define ALOG(fmt, ...)                                                      \
+  do {                                                                      \
+    static constexpr ::alog::log_site alog_site_{fmt, __FILE__, __LINE__};  \
+    ::alog::logger::instance().log(alog_site_, ##__VA_ARGS__);              \
+  } while(0)
+
+#endif
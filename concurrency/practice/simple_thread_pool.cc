@@ -1,11 +1,26 @@
-#include <thread>
 #include <iostream>
 #include <future>
-#include <queue>
+#include <vector>
+#include <memory>
+#include <string>
+#include "simple_thread_pool.h"
 
-class ThreadPool {
-public:
+/**
+ * @brief simple_thread_pool.h 的使用：提交只能移动的任务，以及通过期物取回结果
+ */
 
-private:
-  std::queue<std::thread> q;
-};
\ No newline at end of file
+int main() {
+  ThreadPool pool(4);
+
+  auto state = std::make_unique<int>(42);
+  auto f1 = pool.submit([state = std::move(state)] { return *state; });
+  auto f2 = pool.submit([] { return std::string("hello"); });
+  std::cout << f1.get() << " " << f2.get() << "\n";
+
+  std::vector<std::future<int>> results;
+  for(int i = 0; i < 8; ++i)
+    results.push_back(pool.submit([i] { return i * i; }));
+  for(auto& r : results)
+    std::cout << r.get() << " ";
+  std::cout << "\n";
+}
@@ -0,0 +1,82 @@
+#ifndef SIMPLE_THREAD_POOL_H
+#define SIMPLE_THREAD_POOL_H
+
+#include <thread>
+#include <future>
+#include <queue>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <type_traits>
+#include <utility>
+#include "../../language_runtime_enhance/function_object_wrapper/unique_function.h"
+
+/**
+ * @brief 简单的线程池
+ * 任务队列中保存的是 unique_function<void()>，因此可以直接提交只能移动的任务，
+ * 例如捕获了 unique_ptr 的 lambda，以及 submit 内部使用的 std::packaged_task，
+ * 不需要再为了满足 std::function 的可拷贝要求把状态包进 shared_ptr
+ */
+class ThreadPool {
+public:
+  using Task = unique_function<void()>;
+
+  explicit ThreadPool(std::size_t n = std::thread::hardware_concurrency()) {
+    if(n == 0)
+      n = 1;
+    for(std::size_t i = 0; i < n; ++i)
+      workers.emplace_back([this] { run(); });
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      stop = true;
+    }
+    cv.notify_all();
+    for(auto& t : workers)
+      t.join();
+  }
+
+  /* 提交一个不关心结果的任务 */
+  void post(Task task) {
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      q.push(std::move(task));
+    }
+    cv.notify_one();
+  }
+
+  /* 提交一个任务，通过期物获取结果 */
+  template<typename F, typename R = std::invoke_result_t<std::decay_t<F>&>>
+  std::future<R> submit(F&& func) {
+    std::packaged_task<R()> task(std::forward<F>(func));
+    std::future<R> result = task.get_future();
+    post(std::move(task));
+    return result;
+  }
+
+private:
+  void run() {
+    while(true) {
+      Task task;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this] { return stop || !q.empty(); });
+        if(stop && q.empty())
+          return;
+        task = std::move(q.front());
+        q.pop();
+      }
+      task();
+    }
+  }
+
+  std::vector<std::thread> workers;
+  std::queue<Task> q;
+  std::mutex mtx;
+  std::condition_variable cv;
+  bool stop = false;
+};
+
+#endif
@@ -0,0 +1,293 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * @brief 作用域追踪：每个线程一个无锁环形缓冲区，导出 Chrome / Perfetto 的 JSON 时间线
+ * 线程卡住的时候，最需要的是每个线程在每个时刻在做什么；打日志太慢，也看不出线程之间的交错
+ *
+ * 1. TRACE_SCOPE("name")：在作用域结束时记录一个 [开始, 结束] 区间；名字必须是字符串字面量（只保存指针）
+ * 2. TRACE_INSTANT("name")：记录一个时刻
+ * 3. TRACE_FLOW_BEGIN("name", id) / TRACE_FLOW_END("name", id)：跨线程的交接（例如入队和出队同一个元素），
+ *    在时间线上画成一条从生产者指向消费者的箭头；需要写在某个 TRACE_SCOPE 之内
+ * 4. TRACE_THREAD_NAME("name")：给当前线程起名字
+ * 5. TRACE_DUMP("trace.json")：把所有线程的缓冲区写成 JSON，用 chrome://tracing 或 ui.perfetto.dev 打开
+ *
+ * 时间戳：x86 上用 rdtsc（要求 invariant TSC，近十几年的 CPU 都满足），第一次使用和导出时各取一对 (tsc, steady_clock)，
+ * 用两者的比值换算成纳秒，不需要启动时专门校准；其它平台直接用 steady_clock
+ *
+ * 每个线程的缓冲区只有这个线程写入，写一个事件就是几次普通的 store 加一次 release store，没有锁也没有 RMW；
+ * 缓冲区满了覆盖最旧的事件（飞行记录器）。线程第一次记录事件时在全局表中登记一次（加锁）；
+ * 线程退出时记录一个 "thread exit" 并把缓冲区标记为空闲，之后新的线程优先复用它，所以每个任务一个线程的代码
+ * 占用的缓冲区个数只取决于同时存活的线程数。复用的缓冲区在时间线上是同一条轨道，旧线程的事件在被覆盖之前仍然可见
+ *
+ * 没有定义 TRACE_ENABLED 时所有的宏都展开为空，不包含任何头文件，也没有任何开销
+ */
+
+#ifdef TRACE_ENABLED
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace trace {
+
+#ifndef TRACE_RING_CAPACITY
+#define TRACE_RING_CAPACITY (1u << 16)
+#endif
+
+inline std::uint64_t now_ticks() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+enum class kind : std::uint8_t { complete, instant, flow_begin, flow_end };
+
+/* 字段都是 relaxed 原子量：x86 上和普通的 store 一样，导出线程同时读取时也不是数据竞争 */
+struct event {
+  std::atomic<const char*> name{nullptr};
+  std::atomic<std::uint64_t> begin{0};
+  std::atomic<std::uint64_t> arg{0};  // complete：结束时间；flow：id
+  std::atomic<kind> type{kind::complete};
+};
+
+struct thread_buffer {
+  static constexpr std::uint64_t kCapacity = TRACE_RING_CAPACITY;
+  static_assert((kCapacity & (kCapacity - 1)) == 0, "TRACE_RING_CAPACITY must be a power of two");
+
+  explicit thread_buffer(std::uint32_t tid) : tid(tid), events(new event[kCapacity]) {}
+
+  void record(kind t, const char *name, std::uint64_t begin, std::uint64_t arg) noexcept {
+    std::uint64_t h = head.load(std::memory_order_relaxed);
+    /* 和 dump 中的 acquire 栅栏配对：读到这次写入的槽位，就一定能读到上一次发布的 head */
+    std::atomic_thread_fence(std::memory_order_release);
+    event &e = events[h & (kCapacity - 1)];
+    e.name.store(name, std::memory_order_relaxed);
+    e.begin.store(begin, std::memory_order_relaxed);
+    e.arg.store(arg, std::memory_order_relaxed);
+    e.type.store(t, std::memory_order_relaxed);
+    head.store(h + 1, std::memory_order_release);
+  }
+
+  std::uint32_t tid;
+  std::string name;     // 由 registry 的互斥锁保护
+  bool in_use = true;   // 由 registry 的互斥锁保护
+  std::atomic<std::uint64_t> head{0};
+  std::unique_ptr<event[]> events;
+};
+
+class registry {
+public:
+  static registry& instance() {
+    static registry r;
+    return r;
+  }
+
+  /* 复用的缓冲区保留之前线程的名字，轨道名是历任线程名字的拼接 */
+  void set_thread_name(const char *name) {
+    thread_buffer &b = local();
+    std::lock_guard<std::mutex> lock(mtx);
+    if(b.name.empty())
+      b.name = name;
+    else if(b.name.find(name) == std::string::npos)
+      b.name = b.name + " / " + name;
+  }
+
+  thread_buffer& local() {
+    thread_local owner o{acquire()};
+    return *o.buf;
+  }
+
+  /* 分配过的缓冲区个数（每个 TRACE_RING_CAPACITY 个事件） */
+  std::size_t rings() {
+    std::lock_guard<std::mutex> lock(mtx);
+    return buffers.size();
+  }
+
+  /* 用第一次使用和导出时的两对时间点换算 tick 和纳秒 */
+  double ticks_per_ns() const {
+    std::uint64_t t1 = now_ticks();
+    std::int64_t ns1 = steady_ns();
+    double dt = static_cast<double>(t1 - tsc0), dns = static_cast<double>(ns1 - ns0);
+    return dns > 0 ? dt / dns : 1.0;
+  }
+
+  bool dump(const char *path) {
+    std::FILE *f = std::fopen(path, "w");
+    if(!f)
+      return false;
+    double tpn = ticks_per_ns();
+    std::vector<std::shared_ptr<thread_buffer>> snapshot;
+    std::vector<std::string> names;
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      snapshot = buffers;
+      for(auto &b : buffers)
+        names.push_back(b->name);
+    }
+
+    std::fprintf(f, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+    bool first = true;
+    auto sep = [&] {
+      std::fputs(first ? "  " : ",\n  ", f);
+      first = false;
+    };
+    auto us = [&](std::uint64_t ticks) { return static_cast<double>(ticks - tsc0) / tpn / 1000; };
+    for(std::size_t t = 0; t < snapshot.size(); ++t) {
+      thread_buffer *b = snapshot[t].get();
+      if(!names[t].empty()) {
+        sep();
+        std::fprintf(f, "{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"",
+                     b->tid);
+        write_escaped(f, names[t].c_str());
+        std::fputs("\"}}", f);
+      }
+      /**
+       * 读之前和读之后各取一次 head，读的过程中可能被写线程覆盖的事件都丢掉
+       * 写线程在发布 after + 1 之前就已经在改写 after - kCapacity 这个槽位了，所以它也不可信
+       */
+      std::uint64_t end = b->head.load(std::memory_order_acquire);
+      std::uint64_t begin = end > thread_buffer::kCapacity ? end - thread_buffer::kCapacity : 0;
+      std::vector<std::pair<std::uint64_t, event_copy>> copied;
+      for(std::uint64_t i = begin; i < end; ++i) {
+        const event &e = b->events[i & (thread_buffer::kCapacity - 1)];
+        copied.push_back({i, {e.name.load(std::memory_order_relaxed), e.begin.load(std::memory_order_relaxed),
+                              e.arg.load(std::memory_order_relaxed), e.type.load(std::memory_order_relaxed)}});
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      std::uint64_t after = b->head.load(std::memory_order_relaxed);
+      std::uint64_t valid_from = after + 1 > thread_buffer::kCapacity ? after + 1 - thread_buffer::kCapacity : 0;
+      for(auto &[index, e] : copied) {
+        if(index < valid_from || !e.name)
+          continue;
+        sep();
+        std::fputs("{\"name\": \"", f);
+        write_escaped(f, e.name);
+        switch(e.type) {
+          case kind::complete:
+            std::fprintf(f, "\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f", us(e.begin),
+                         static_cast<double>(e.arg - e.begin) / tpn / 1000);
+            break;
+          case kind::instant:
+            std::fprintf(f, "\", \"ph\": \"i\", \"s\": \"t\", \"ts\": %.3f", us(e.begin));
+            break;
+          case kind::flow_begin:
+            std::fprintf(f, "\", \"cat\": \"flow\", \"ph\": \"s\", \"id\": %llu, \"ts\": %.3f",
+                         static_cast<unsigned long long>(e.arg), us(e.begin));
+            break;
+          case kind::flow_end:
+            std::fprintf(f, "\", \"cat\": \"flow\", \"ph\": \"f\", \"bp\": \"e\", \"id\": %llu, \"ts\": %.3f",
+                         static_cast<unsigned long long>(e.arg), us(e.begin));
+            break;
+        }
+        std::fprintf(f, ", \"pid\": 1, \"tid\": %u}", b->tid);
+      }
+    }
+    std::fputs("\n]}\n", f);
+    return std::fclose(f) == 0;
+  }
+
+private:
+  struct event_copy {
+    const char *name;
+    std::uint64_t begin, arg;
+    kind type;
+  };
+
+  registry() : tsc0(now_ticks()), ns0(steady_ns()) {}
+
+  static std::int64_t steady_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /* 线程退出时通过 thread_local 的析构归还缓冲区 */
+  struct owner {
+    thread_buffer *buf;
+    ~owner() { instance().release(buf); }
+  };
+
+  /* 互斥锁保证上一个线程的写入先于下一个线程的写入 */
+  thread_buffer* acquire() {
+    std::lock_guard<std::mutex> lock(mtx);
+    for(auto &b : buffers) {
+      if(!b->in_use) {
+        b->in_use = true;
+        return b.get();
+      }
+    }
+    buffers.push_back(std::make_shared<thread_buffer>(static_cast<std::uint32_t>(buffers.size() + 1)));
+    return buffers.back().get();
+  }
+
+  void release(thread_buffer *b) {
+    b->record(kind::instant, "thread exit", now_ticks(), 0);
+    std::lock_guard<std::mutex> lock(mtx);
+    b->in_use = false;
+  }
+
+  static void write_escaped(std::FILE *f, const char *s) {
+    for(; *s; ++s) {
+      if(*s == '"' || *s == '\\')
+        std::fputc('\\', f);
+      std::fputc(*s, f);
+    }
+  }
+
+  std::uint64_t tsc0;
+  std::int64_t ns0;
+  std::mutex mtx;
+  std::vector<std::shared_ptr<thread_buffer>> buffers;
+};
+
+class scope {
+public:
+  explicit scope(const char *name) noexcept : buf(registry::instance().local()), name(name), begin(now_ticks()) {}
+  ~scope() { buf.record(kind::complete, name, begin, now_ticks()); }
+  scope(const scope&) = delete;
+  scope& operator=(const scope&) = delete;
+
+private:
+  thread_buffer &buf;
+  const char *name;
+  std::uint64_t begin;
+};
+
+inline void record(kind t, const char *name, std::uint64_t arg = 0) {
+  registry::instance().local().record(t, name, now_ticks(), arg);
+}
+
+}  // namespace trace
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) ::trace::scope TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_INSTANT(name) ::trace::record(::trace::kind::instant, name)
+#define TRACE_FLOW_BEGIN(name, id) ::trace::record(::trace::kind::flow_begin, name, static_cast<std::uint64_t>(id))
+#define TRACE_FLOW_END(name, id) ::trace::record(::trace::kind::flow_end, name, static_cast<std::uint64_t>(id))
+#define TRACE_THREAD_NAME(name) ::trace::registry::instance().set_thread_name(name)
+#define TRACE_DUMP(path) ::trace::registry::instance().dump(path)
+
+#else
+
+/* sizeof 不对参数求值，只是让只在追踪中用到的变量不产生 unused 警告 */
+#define TRACE_SCOPE(name) ((void)sizeof(name))
+#define TRACE_INSTANT(name) ((void)sizeof(name))
+#define TRACE_FLOW_BEGIN(name, id) ((void)sizeof(name), (void)sizeof(id))
+#define TRACE_FLOW_END(name, id) ((void)sizeof(name), (void)sizeof(id))
+#define TRACE_THREAD_NAME(name) ((void)sizeof(name))
+#define TRACE_DUMP(path) ((void)sizeof(path), true)
+
+#endif  // TRACE_ENABLED
+
+#endif  // TRACE_H
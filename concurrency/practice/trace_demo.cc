@@ -0,0 +1,178 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "trace.h"
+
+/**
+ * @brief trace.h 的使用示例：把 concurrency/ 下三个示例的模式放在一起，导出一条时间线
+ * 1. condition_variable.cc：有界队列的生产者和消费者，每个元素从入队到出队画一条箭头（queue hand-off）
+ * 2. lock.cc：几个线程抢同一把锁，"wait lock" 区间就是在锁上排队的时间，"critical section" 是持有锁的时间
+ * 3. memory_order.cc：release / acquire 的发布，消费者自旋等待标志位的时间是 "spin acquire"
+ *
+ * 编译：g++ -std=c++17 -O2 -pthread -DTRACE_ENABLED concurrency/practice/trace_demo.cc -o trace_demo
+ * 运行后用 chrome://tracing 或 ui.perfetto.dev 打开 trace_demo.json
+ * 不加 -DTRACE_ENABLED 时所有的 TRACE_* 都是空的，程序照常运行
+ */
+
+/* ---- condition_variable.cc：有界队列，入队和出队之间用 flow 连起来 ---- */
+void queue_hand_off() {
+  constexpr std::size_t kCapacity = 4;
+  constexpr int kItems = 64;
+  std::queue<int> q;
+  std::mutex mtx;
+  std::condition_variable not_empty, not_full;
+  bool done = false;
+
+  auto producer = [&] {
+    TRACE_THREAD_NAME("producer");
+    for(int i = 0; i < kItems; ++i) {
+      TRACE_SCOPE("produce");
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+      std::unique_lock<std::mutex> lock(mtx);
+      {
+        TRACE_SCOPE("wait not_full");
+        not_full.wait(lock, [&] { return q.size() < kCapacity; });
+      }
+      TRACE_FLOW_BEGIN("item", i);
+      q.push(i);
+      not_empty.notify_one();
+    }
+    std::lock_guard<std::mutex> lock(mtx);
+    done = true;
+    not_empty.notify_all();
+  };
+
+  auto consumer = [&](const char *name) {
+    TRACE_THREAD_NAME(name);
+    for(;;) {
+      int item;
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        {
+          TRACE_SCOPE("wait not_empty");
+          not_empty.wait(lock, [&] { return done || !q.empty(); });
+        }
+        if(q.empty())
+          return;
+        item = q.front();
+        q.pop();
+        not_full.notify_one();
+      }
+      TRACE_SCOPE("consume");
+      TRACE_FLOW_END("item", item);
+      std::this_thread::sleep_for(std::chrono::microseconds(120));
+    }
+  };
+
+  std::thread p(producer), c1(consumer, "consumer 1"), c2(consumer, "consumer 2");
+  p.join();
+  c1.join();
+  c2.join();
+}
+
+/* ---- lock.cc：锁竞争，等待锁和持有锁分成两个区间 ---- */
+void lock_contention() {
+  std::mutex mtx;
+  int v = 0;
+  auto worker = [&](const char *name) {
+    TRACE_THREAD_NAME(name);
+    for(int i = 0; i < 20; ++i) {
+      std::unique_lock<std::mutex> lock(mtx, std::defer_lock);
+      {
+        TRACE_SCOPE("wait lock");
+        lock.lock();
+      }
+      TRACE_SCOPE("critical section");
+      ++v;
+      std::this_thread::sleep_for(std::chrono::microseconds(30));
+    }
+  };
+  std::vector<std::thread> vt;
+  for(const char *name : {"locker 1", "locker 2", "locker 3"})
+    vt.emplace_back(worker, name);
+  for(auto &t : vt)
+    t.join();
+  std::cout << "lock contention: v = " << v << "\n";
+}
+
+/* ---- memory_order.cc：release 发布数据，acquire 自旋等待 ---- */
+void release_acquire() {
+  std::atomic<bool> ready{false};
+  int payload = 0;
+  std::thread consumer([&] {
+    TRACE_THREAD_NAME("acquire");
+    {
+      TRACE_SCOPE("spin acquire");
+      while(!ready.load(std::memory_order_acquire))
+        std::this_thread::yield();
+    }
+    TRACE_SCOPE("read payload");
+    TRACE_FLOW_END("publish", 1);
+    std::cout << "release/acquire: payload = " << payload << "\n";
+  });
+  std::thread producer([&] {
+    TRACE_THREAD_NAME("release");
+    TRACE_SCOPE("publish");
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    payload = 42;
+    TRACE_FLOW_BEGIN("publish", 1);
+    ready.store(true, std::memory_order_release);
+  });
+  producer.join();
+  consumer.join();
+}
+
+/* 每个任务一个线程：退出的线程归还缓冲区，缓冲区的个数不随任务数增长 */
+void thread_per_task() {
+  constexpr int kTasks = 200;
+  int sum = 0;
+  for(int i = 0; i < kTasks; ++i) {
+    sum += std::async(std::launch::async, [i] {
+      TRACE_SCOPE("task");
+      return i;
+    }).get();
+  }
+  std::cout << "thread per task: " << kTasks << " tasks, sum = " << sum;
+#ifdef TRACE_ENABLED
+  std::cout << ", rings allocated = " << ::trace::registry::instance().rings();
+#endif
+  std::cout << "\n";
+}
+
+/* 单个 TRACE_SCOPE 的开销：空作用域反复进入退出；放在单独的线程里，环形缓冲区被它写满也不会挤掉其它线程的事件 */
+void measure_overhead() {
+  TRACE_THREAD_NAME("overhead");
+  constexpr int kIterations = 1 << 22;
+  auto start = std::chrono::steady_clock::now();
+  for(int i = 0; i < kIterations; ++i) {
+    TRACE_SCOPE("empty");
+    asm volatile("" ::: "memory");
+  }
+  auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  std::printf("TRACE_SCOPE overhead: %.1f ns per scope\n", ns / kIterations);
+}
+
+int main() {
+  TRACE_THREAD_NAME("main");
+  std::thread(measure_overhead).join();
+  queue_hand_off();
+  lock_contention();
+  release_acquire();
+  thread_per_task();
+#ifdef TRACE_ENABLED
+  if(TRACE_DUMP("trace_demo.json"))
+    std::cout << "trace written to trace_demo.json\n";
+  else
+    std::cout << "failed to write trace_demo.json\n";
+#else
+  std::cout << "tracing disabled, build with -DTRACE_ENABLED to record a trace\n";
+#endif
+}
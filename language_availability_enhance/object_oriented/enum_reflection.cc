@@ -0,0 +1,469 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 编译期的枚举反射
+ * enum_class.cc 中只能把 new_enum 转换为底层的整数来输出；协议解析时需要在名字和值之间来回转换，
+ * 常见的写法是 std::map<std::string, E>，每次查找都是若干次字符串比较和指针跳转
+ *
+ * 1. 枚举值的发现：对范围内的每个整数 V 实例化 name_of<E, V>()，__PRETTY_FUNCTION__ 中会出现 "V = E::name"，
+ *    不是合法枚举值的整数则显示为 "(E)5"，据此在编译期得到所有的枚举值和名字
+ *    范围默认为 [-128, 255] 与底层型别的交集，可以特化 enum_range<E> 修改
+ * 2. to_string：值的分布足够稠密时用 (v - min) 作下标的数组，否则对有序的值二分查找
+ * 3. from_string：编译期构造完美哈希（hash-and-displace）：名字的哈希先分到约 n/4 个桶里，
+ *    从最大的桶开始，为每个桶找一个位移 d，使桶内所有名字落到表中还空着的槽位；每个桶平均只需要尝试几次，
+ *    总的工作量与名字个数成正比，几百个名字的枚举也能在编译期完成
+ *    查找时计算一次哈希、读一次位移、比较一次字符串；哈希只读取长度和首尾各 8 个字节，没有循环
+ *
+ * 重复的值：value3 = value4 = 100 时，编译器对值 100 只会给出第一个名字 value3，value4 无法被自动发现，
+ * 所以 to_string(100) 总是返回 "value3"；需要按别名解析时特化 enum_aliases<E> 补充名字
+ */
+namespace refl {
+
+/* C++17 中 std::pair 的赋值不是 constexpr 的 */
+template<typename E>
+struct entry {
+  E value;
+  std::string_view name;
+};
+
+template<typename E>
+struct enum_range {
+  static constexpr int min = -128;
+  static constexpr int max = 255;
+};
+
+/* 同一个值的额外名字，默认没有 */
+template<typename E>
+struct enum_aliases {
+  static constexpr std::array<entry<E>, 0> value{};
+};
+
+namespace detail {
+
+template<typename E, E V>
+constexpr std::string_view name_of() {
+  std::string_view s = __PRETTY_FUNCTION__;
+  std::size_t begin = s.find("V = ") + 4;
+  std::size_t end = s.find_first_of(";]", begin);
+  s = s.substr(begin, end - begin);
+  if(s.empty() || s[0] == '(')  // (E)5：不是一个枚举值
+    return {};
+  std::size_t colon = s.rfind("::");
+  return colon == std::string_view::npos ? s : s.substr(colon + 2);
+}
+
+template<typename E>
+using underlying = std::underlying_type_t<E>;
+
+template<typename E>
+constexpr long long range_min() {
+  return std::max<long long>(enum_range<E>::min, std::numeric_limits<underlying<E>>::min());
+}
+
+template<typename E>
+constexpr long long range_max() {
+  return std::min<long long>(enum_range<E>::max, std::numeric_limits<underlying<E>>::max());
+}
+
+template<typename E, std::size_t... I>
+constexpr auto all_names(std::index_sequence<I...>) {
+  return std::array<std::string_view, sizeof...(I)>{
+      name_of<E, static_cast<E>(range_min<E>() + static_cast<long long>(I))>()...};
+}
+
+/* 范围内每个整数对应的名字，空表示不是枚举值 */
+template<typename E>
+inline constexpr auto scanned = all_names<E>(std::make_index_sequence<range_max<E>() - range_min<E>() + 1>{});
+
+template<typename E>
+constexpr std::size_t count_valid() {
+  std::size_t n = 0;
+  for(auto s : scanned<E>)
+    n += !s.empty();
+  return n;
+}
+
+/* 读取 n（不超过 8）个字节拼成小端序的整数；运行期 8 个字节时直接用一次读取 */
+constexpr std::uint64_t load_le(std::string_view s, std::size_t pos, std::size_t n) {
+  if(!__builtin_is_constant_evaluated() && n == 8) {
+    std::uint64_t w = 0;
+    std::memcpy(&w, s.data() + pos, 8);
+    return w;
+  }
+  std::uint64_t w = 0;
+  for(std::size_t k = 0; k < n; ++k)
+    w |= static_cast<std::uint64_t>(static_cast<unsigned char>(s[pos + k])) << (8 * k);
+  return w;
+}
+
+constexpr std::uint64_t mix(std::uint64_t h) {
+  h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+  h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+  return h ^ (h >> 31);
+}
+
+/**
+ * Full = false：只使用长度、开头 8 个字节和结尾 8 个字节（可以重叠），与长度无关的常数时间，没有循环
+ * Full = true：处理全部字节，只有在已知的名字中有两个的长度、开头、结尾都相同时才需要
+ * 完美哈希只要求已知的名字互不冲突，其它字符串最后都要比较一次名字
+ */
+template<bool Full>
+constexpr std::uint64_t hash_name(std::string_view s, std::uint64_t seed) {
+  std::size_t n = s.size();
+  std::uint64_t h = seed ^ (n * 0x9E3779B97F4A7C15ull);
+  if constexpr(Full) {
+    for(std::size_t i = 0; i < n; i += 8)
+      h = mix(h ^ load_le(s, i, std::min<std::size_t>(8, n - i)));
+  } else {
+    h = mix(h ^ load_le(s, 0, std::min<std::size_t>(8, n)));
+    if(n > 8)
+      h = mix(h ^ load_le(s, n - 8, 8));
+  }
+  return h;
+}
+
+constexpr std::size_t next_pow2(std::size_t n) {
+  std::size_t p = 1;
+  while(p < n)
+    p <<= 1;
+  return p;
+}
+
+/**
+ * 名字在表中的槽位：低位选桶，高位给出起点 h1 和步长 h2（奇数），位移 d 沿 h1 + d * h2 移动
+ * 表长是 2 的幂，步长为奇数时 d 取遍 [0, 表长) 会经过每一个槽位
+ */
+constexpr std::size_t displaced_slot(std::uint64_t h, std::uint32_t d, std::size_t mask) {
+  std::uint64_t h1 = h >> 32, h2 = (h >> 16) | 1;
+  return static_cast<std::size_t>(h1 + d * h2) & mask;
+}
+
+}  // namespace detail
+
+/* 反射得到的全部信息，全部是编译期常量 */
+template<typename E>
+struct enum_traits {
+  static constexpr std::size_t count = detail::count_valid<E>();
+  static_assert(count > 0, "no enumerators found in enum_range<E>");
+
+  /* 按值升序排列的枚举值和名字 */
+  static constexpr auto entries = [] {
+    std::array<entry<E>, count> out{};
+    std::size_t k = 0;
+    for(std::size_t i = 0; i < detail::scanned<E>.size(); ++i)
+      if(!detail::scanned<E>[i].empty())
+        out[k++] = {static_cast<E>(detail::range_min<E>() + static_cast<long long>(i)), detail::scanned<E>[i]};
+    return out;
+  }();
+
+  static constexpr long long min = static_cast<long long>(entries.front().value);
+  static constexpr long long max = static_cast<long long>(entries.back().value);
+
+  /* 跨度不超过枚举值个数的 4 倍（外加 64）时使用稠密数组 */
+  static constexpr bool dense = max - min + 1 <= static_cast<long long>(4 * count + 64);
+  static constexpr std::size_t dense_size = dense ? static_cast<std::size_t>(max - min + 1) : 1;
+  static constexpr auto dense_names = [] {
+    std::array<std::string_view, dense_size> out{};
+    if constexpr(dense)
+      for(auto &e : entries)
+        out[static_cast<long long>(e.value) - min] = e.name;
+    return out;
+  }();
+
+  /* from_string 的名字包括所有的别名 */
+  static constexpr std::size_t name_count = count + enum_aliases<E>::value.size();
+  static constexpr auto names = [] {
+    std::array<entry<E>, name_count> out{};
+    std::size_t k = 0;
+    for(auto &e : entries)
+      out[k++] = e;
+    for(auto &a : enum_aliases<E>::value)
+      out[k++] = a;
+    return out;
+  }();
+
+  /* 长度、开头 8 个字节、结尾 8 个字节都相同的两个名字只能用完整的哈希区分 */
+  static constexpr bool full_hash = [] {
+    for(std::size_t i = 0; i < name_count; ++i)
+      for(std::size_t j = i + 1; j < name_count; ++j) {
+        std::string_view a = names[i].name, b = names[j].name;
+        if(a.size() == b.size() && a.substr(0, 8) == b.substr(0, 8) &&
+           a.substr(a.size() > 8 ? a.size() - 8 : 0) == b.substr(b.size() > 8 ? b.size() - 8 : 0))
+          return true;
+      }
+    return false;
+  }();
+
+  /**
+   * hash-and-displace：表长为名字个数 2 倍以上的 2 的幂，平均每个桶 4 个名字以内
+   * 桶按大小从大到小放置，先放的桶面对的表比较空；某个桶试遍所有位移仍然放不下时（两个名字的哈希高位完全相同）换一个种子重来
+   */
+  static_assert(name_count < 32768, "too many enumerators for the int16 hash table");
+  static constexpr std::size_t table_size = detail::next_pow2(name_count * 2);
+  static constexpr std::size_t bucket_count = detail::next_pow2((name_count + 3) / 4);
+
+  struct perfect_hash {
+    std::uint64_t seed = 0;
+    std::array<std::uint32_t, bucket_count> displacement{};
+    std::array<std::int16_t, table_size> table{};
+  };
+
+  static constexpr bool try_build(std::uint64_t seed, perfect_hash &out) {
+    std::array<std::uint64_t, name_count> h{};
+    std::array<std::size_t, bucket_count + 1> start{};
+    for(std::size_t i = 0; i < name_count; ++i) {
+      h[i] = detail::hash_name<full_hash>(names[i].name, seed);
+      ++start[(h[i] & (bucket_count - 1)) + 1];
+    }
+    /* 计数排序：members[start[b], start[b + 1]) 是桶 b 中的名字 */
+    std::size_t largest = 0;
+    for(std::size_t b = 0; b < bucket_count; ++b) {
+      largest = std::max(largest, start[b + 1]);
+      start[b + 1] += start[b];
+    }
+    std::array<std::size_t, bucket_count> fill{};
+    std::array<std::size_t, name_count> members{};
+    for(std::size_t i = 0; i < name_count; ++i) {
+      std::size_t b = h[i] & (bucket_count - 1);
+      members[start[b] + fill[b]++] = i;
+    }
+
+    out.seed = seed;
+    for(auto &slot : out.table)
+      slot = -1;
+    for(std::size_t size = largest; size > 0; --size) {
+      for(std::size_t b = 0; b < bucket_count; ++b) {
+        if(start[b + 1] - start[b] != size)
+          continue;
+        bool placed = false;
+        for(std::uint32_t d = 0; d < table_size && !placed; ++d) {
+          placed = true;
+          for(std::size_t k = start[b]; k < start[b + 1] && placed; ++k) {
+            std::size_t slot = detail::displaced_slot(h[members[k]], d, table_size - 1);
+            /* 同一个桶内的两个名字也不能落到同一个槽位 */
+            for(std::size_t j = start[b]; j < k && placed; ++j)
+              placed = detail::displaced_slot(h[members[j]], d, table_size - 1) != slot;
+            placed = placed && out.table[slot] < 0;
+          }
+          if(placed) {
+            out.displacement[b] = d;
+            for(std::size_t k = start[b]; k < start[b + 1]; ++k)
+              out.table[detail::displaced_slot(h[members[k]], d, table_size - 1)] = static_cast<std::int16_t>(members[k]);
+          }
+        }
+        if(!placed)
+          return false;
+      }
+    }
+    return true;
+  }
+
+  static constexpr perfect_hash build() {
+    perfect_hash out{};
+    for(std::uint64_t seed = 0; !try_build(seed, out); ++seed) {
+    }
+    return out;
+  }
+
+  static constexpr perfect_hash hash = build();
+  static constexpr std::uint64_t seed = hash.seed;
+};
+
+template<typename E>
+constexpr std::size_t enum_count() { return enum_traits<E>::count; }
+
+template<typename E>
+constexpr auto enum_values() {
+  std::array<E, enum_traits<E>::count> out{};
+  for(std::size_t i = 0; i < out.size(); ++i)
+    out[i] = enum_traits<E>::entries[i].value;
+  return out;
+}
+
+/* 不是枚举值时返回空的 string_view */
+template<typename E>
+constexpr std::string_view to_string(E e) {
+  using T = enum_traits<E>;
+  long long v = static_cast<long long>(e);
+  if(v < T::min || v > T::max)
+    return {};
+  if constexpr(T::dense) {
+    return T::dense_names[v - T::min];
+  } else {
+    /* C++17 中 std::lower_bound 不是 constexpr 的 */
+    std::size_t lo = 0, hi = T::count;
+    while(lo < hi) {
+      std::size_t mid = (lo + hi) / 2;
+      if(static_cast<long long>(T::entries[mid].value) < v)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    return lo < T::count && T::entries[lo].value == e ? T::entries[lo].name : std::string_view{};
+  }
+}
+
+template<typename E>
+constexpr std::optional<E> from_string(std::string_view s) {
+  using T = enum_traits<E>;
+  std::uint64_t h = detail::hash_name<T::full_hash>(s, T::seed);
+  std::uint32_t d = T::hash.displacement[h & (T::bucket_count - 1)];
+  std::int16_t i = T::hash.table[detail::displaced_slot(h, d, T::table_size - 1)];
+  if(i < 0 || T::names[i].name != s)
+    return std::nullopt;
+  return T::names[i].value;
+}
+
+}  // namespace refl
+
+/* enum_class.cc 中的枚举 */
+enum class new_enum : unsigned int {
+  value1,
+  value2,
+  value3 = 100,
+  value4 = 100
+};
+
+template<>
+struct refl::enum_aliases<new_enum> {
+  static constexpr std::array<refl::entry<new_enum>, 1> value{{{new_enum::value4, "value4"}}};
+};
+
+static_assert(refl::enum_count<new_enum>() == 3, "value3 and value4 share one value");
+static_assert(refl::to_string(new_enum::value4) == "value3", "");
+static_assert(refl::from_string<new_enum>("value4") == new_enum::value3, "");
+static_assert(!refl::from_string<new_enum>("value5"), "");
+
+/* 协议中的消息型别，值比较稀疏 */
+enum class msg_type : std::int16_t {
+  heartbeat = 0, test_request = 1, resend_request = 2, reject = 3, sequence_reset = 4, logout = 5,
+  execution_report = 8, order_cancel_reject = 9, logon = 10, news = 11, email = 12,
+  new_order_single = 20, new_order_list = 21, order_cancel_request = 22, order_status_request = 23,
+  allocation = 30, list_cancel_request = 31, list_execute = 32, quote_request = 40, quote = 41,
+  market_data_request = 60, market_data_snapshot = 61, market_data_incremental = 62,
+  security_definition = 90, security_status = 91, trading_session_status = 95,
+  mass_quote = 105, business_reject = 120, bid_request = 125, user_request = -10
+};
+
+/* 大的协议枚举：150 个名字，长度和开头都相同；完美哈希的构造只与名字个数成线性关系 */
+enum class wide_enum : std::uint8_t {
+  field_000, field_001, field_002, field_003, field_004, field_005, field_006, field_007, field_008, field_009,
+  field_010, field_011, field_012, field_013, field_014, field_015, field_016, field_017, field_018, field_019,
+  field_020, field_021, field_022, field_023, field_024, field_025, field_026, field_027, field_028, field_029,
+  field_030, field_031, field_032, field_033, field_034, field_035, field_036, field_037, field_038, field_039,
+  field_040, field_041, field_042, field_043, field_044, field_045, field_046, field_047, field_048, field_049,
+  field_050, field_051, field_052, field_053, field_054, field_055, field_056, field_057, field_058, field_059,
+  field_060, field_061, field_062, field_063, field_064, field_065, field_066, field_067, field_068, field_069,
+  field_070, field_071, field_072, field_073, field_074, field_075, field_076, field_077, field_078, field_079,
+  field_080, field_081, field_082, field_083, field_084, field_085, field_086, field_087, field_088, field_089,
+  field_090, field_091, field_092, field_093, field_094, field_095, field_096, field_097, field_098, field_099,
+  field_100, field_101, field_102, field_103, field_104, field_105, field_106, field_107, field_108, field_109,
+  field_110, field_111, field_112, field_113, field_114, field_115, field_116, field_117, field_118, field_119,
+  field_120, field_121, field_122, field_123, field_124, field_125, field_126, field_127, field_128, field_129,
+  field_130, field_131, field_132, field_133, field_134, field_135, field_136, field_137, field_138, field_139,
+  field_140, field_141, field_142, field_143, field_144, field_145, field_146, field_147, field_148, field_149
+};
+
+template<typename E>
+constexpr bool round_trips() {
+  for(auto v : refl::enum_values<E>())
+    if(refl::from_string<E>(refl::to_string(v)) != v)
+      return false;
+  return true;
+}
+
+static_assert(refl::enum_count<wide_enum>() == 150, "");
+static_assert(round_trips<wide_enum>(), "every enumerator must be found by its own name");
+static_assert(refl::from_string<wide_enum>("field_149") == wide_enum::field_149, "");
+static_assert(!refl::from_string<wide_enum>("field_150"), "");
+
+template<typename E>
+std::ostream& operator<<(typename std::enable_if<std::is_enum<E>::value, std::ostream>::type &os, E e) {
+  std::string_view name = refl::to_string(e);
+  if(name.empty())
+    return os << static_cast<long long>(e);
+  return os << name;
+}
+
+using ns = std::chrono::duration<double, std::nano>;
+
+template<typename F>
+void bench(const char *name, F f) {
+  constexpr int kIters = 20000000;
+  long long sum = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for(int i = 0; i < kIters; ++i) {
+    asm volatile("" : "+r"(i));
+    sum += f(i);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "  " << name << ": " << ns(t1 - t0).count() / kIters << " ns/op (" << sum << ")\n";
+}
+
+int main() {
+  std::cout << new_enum::value1 << " " << new_enum::value4 << " " << static_cast<new_enum>(7) << "\n";
+  for(auto v : refl::enum_values<new_enum>())
+    std::cout << static_cast<unsigned>(v) << " = " << refl::to_string(v) << "\n";
+
+  using T = refl::enum_traits<msg_type>;
+  std::cout << "msg_type: " << T::count << " values, dense table " << std::boolalpha << T::dense
+            << " (" << T::dense_size << " slots), perfect hash seed " << T::seed
+            << ", " << T::table_size << " slots\n";
+
+  /* 基于 map 的实现 */
+  std::map<std::string, msg_type> by_name;
+  std::unordered_map<std::string, msg_type> by_name_hash;
+  std::map<msg_type, std::string> by_value;
+  for(auto &e : T::entries) {
+    by_name.emplace(std::string(e.name), e.value);
+    by_name_hash.emplace(std::string(e.name), e.value);
+    by_value.emplace(e.value, std::string(e.name));
+  }
+
+  /* 报文中解析出来的名字，先放好避免计入构造字符串的开销 */
+  std::vector<std::string> names;
+  std::vector<msg_type> values;
+  for(auto &e : T::entries) {
+    names.emplace_back(e.name);
+    values.push_back(e.value);
+  }
+  names.emplace_back("unknown_message");
+  const std::size_t n = names.size();
+
+  std::cout << "from_string:\n";
+  bench("std::map<std::string, E>      ", [&](int i) {
+    auto it = by_name.find(names[i % n]);
+    return it == by_name.end() ? -1 : static_cast<int>(it->second);
+  });
+  bench("std::unordered_map            ", [&](int i) {
+    auto it = by_name_hash.find(names[i % n]);
+    return it == by_name_hash.end() ? -1 : static_cast<int>(it->second);
+  });
+  bench("refl::from_string (perf. hash)", [&](int i) {
+    auto v = refl::from_string<msg_type>(names[i % n]);
+    return v ? static_cast<int>(*v) : -1;
+  });
+
+  std::cout << "to_string:\n";
+  bench("std::map<E, std::string>      ", [&](int i) {
+    return static_cast<int>(by_value.find(values[i % values.size()])->second.size());
+  });
+  bench("refl::to_string (dense table) ", [&](int i) {
+    return static_cast<int>(refl::to_string(values[i % values.size()]).size());
+  });
+}
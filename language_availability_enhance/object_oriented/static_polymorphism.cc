@@ -0,0 +1,325 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+#include <variant>
+#include <vector>
+
+/**
+ * @brief CRTP 静态多态与批量分发
+ * inheirt_construct.cc、commission_construct.cc 只用到了普通的继承；实际的类层次中，紧凑的循环里调用虚函数有几笔开销：
+ * 间接跳转很难预测（类型交错出现时）、无法内联、对象分散在堆上、每个对象多一个虚表指针
+ *
+ * 1. crtp<Derived, Interface>：提供 self()，接口基类（例如下面的 shape<Derived>）把调用静态地转发给派生类的 xxx_impl，
+ *    编译器可以完全内联；接口基类的构造函数中检查派生类是否实现了要求的函数，缺少时给出明确的错误
+ *    两层都把构造函数设为 private 并声明友元：crtp 只能被 Interface<Derived> 继承，shape<D> 只能被 D 继承，
+ *    写错模板参数（struct X : shape<Y>）时编译报错，而不是让 self() 静默地转换成错误的类型
+ * 2. closed_hierarchy<Ts...>：类型集合在编译期已知（封闭的类层次）时，按具体类型把对象分到各自的 vector 中，
+ *    for_each / reduce 对每种类型跑一个紧凑的、内联的循环，循环内部没有任何分发
+ *    代价是不再保持对象之间的原有顺序，只适用于每个对象的处理互不依赖的场合
+ *
+ * 测试：1000 万个随机交错的图形求面积之和，对比
+ * 虚函数（堆上的对象）、final 类（按类型分组，静态类型已知时去虚化）、std::variant + std::visit、CRTP + closed_hierarchy
+ */
+
+template<typename Derived, template<typename> class Interface>
+class crtp {
+protected:
+  Derived& self() noexcept { return static_cast<Derived&>(*this); }
+  const Derived& self() const noexcept { return static_cast<const Derived&>(*this); }
+
+private:
+  crtp() noexcept = default;
+  friend Interface<Derived>;
+};
+
+template<typename D, typename = void>
+struct has_area_impl : std::false_type {};
+template<typename D>
+struct has_area_impl<D, std::void_t<decltype(std::declval<const D&>().area_impl())>> : std::true_type {};
+
+template<typename D, typename = void>
+struct has_scale_impl : std::false_type {};
+template<typename D>
+struct has_scale_impl<D, std::void_t<decltype(std::declval<D&>().scale_impl(1.0f))>> : std::true_type {};
+
+/* 接口：构造时 Derived 已经是完整类型，可以在这里检查 */
+template<typename Derived>
+class shape : public crtp<Derived, shape> {
+public:
+  float area() const { return this->self().area_impl(); }
+  void scale(float k) { this->self().scale_impl(k); }
+
+private:
+  shape() noexcept {
+    static_assert(has_area_impl<Derived>::value, "shape<D> requires float D::area_impl() const");
+    static_assert(has_scale_impl<Derived>::value, "shape<D> requires void D::scale_impl(float)");
+  }
+  friend Derived;
+};
+
+/* 任何实现了 shape 接口的类型都可以传进来，调用在编译期确定 */
+template<typename D>
+float doubled_area(const shape<D> &s) { return 2 * s.area(); }
+
+template<typename... Ts>
+class closed_hierarchy {
+public:
+  template<typename T, typename... Args>
+  T& emplace(Args&&... args) {
+    return batch<T>().emplace_back(std::forward<Args>(args)...);
+  }
+
+  /* 把一组 variant 按具体类型分组 */
+  template<typename Range>
+  void assign(const Range &objects) {
+    std::apply([](auto&... v) { (v.clear(), ...); }, batches);
+    for(const auto &obj : objects)
+      std::visit([this](const auto &x) { batch<std::decay_t<decltype(x)>>().push_back(x); }, obj);
+  }
+
+  template<typename T>
+  std::vector<T>& batch() noexcept { return std::get<std::vector<T>>(batches); }
+  template<typename T>
+  const std::vector<T>& batch() const noexcept { return std::get<std::vector<T>>(batches); }
+
+  std::size_t size() const noexcept {
+    return std::apply([](const auto&... v) { return (std::size_t(0) + ... + v.size()); }, batches);
+  }
+
+  /* 对每种类型实例化一次 f，每个批次内部是普通的循环 */
+  template<typename F>
+  void for_each(F &&f) {
+    std::apply([&f](auto&... v) { (run(v, f), ...); }, batches);
+  }
+
+  template<typename R, typename F>
+  R reduce(R init, F &&f) const {
+    std::apply([&](const auto&... v) { ((init = reduce_batch(v, init, f)), ...); }, batches);
+    return init;
+  }
+
+private:
+  template<typename V, typename F>
+  static void run(V &v, F &f) {
+    for(auto &x : v)
+      f(x);
+  }
+
+  template<typename V, typename R, typename F>
+  static R reduce_batch(const V &v, R acc, F &f) {
+    for(const auto &x : v)
+      acc += f(x);
+    return acc;
+  }
+
+  std::tuple<std::vector<Ts>...> batches;
+};
+
+/* ------------------------------ 测试 ------------------------------ */
+/* 同样的四种图形写成两套：虚函数版本和 CRTP 版本；CRTP 版本是没有虚表指针的值类型，也直接用于 variant */
+struct shape_base {
+  virtual ~shape_base() = default;
+  virtual float area() const = 0;
+};
+
+struct circle_v final : shape_base {
+  explicit circle_v(float r) : r(r) {}
+  float area() const override { return 3.14159265f * r * r; }
+  float r;
+};
+struct square_v final : shape_base {
+  explicit square_v(float a) : a(a) {}
+  float area() const override { return a * a; }
+  float a;
+};
+struct rect_v final : shape_base {
+  rect_v(float w, float h) : w(w), h(h) {}
+  float area() const override { return w * h; }
+  float w, h;
+};
+struct triangle_v final : shape_base {
+  triangle_v(float b, float h) : b(b), h(h) {}
+  float area() const override { return 0.5f * b * h; }
+  float b, h;
+};
+
+struct circle : shape<circle> {
+  explicit circle(float r) : r(r) {}
+  float area_impl() const { return 3.14159265f * r * r; }
+  void scale_impl(float k) { r *= k; }
+  float r;
+};
+struct square : shape<square> {
+  explicit square(float a) : a(a) {}
+  float area_impl() const { return a * a; }
+  void scale_impl(float k) { a *= k; }
+  float a;
+};
+struct rect : shape<rect> {
+  rect(float w, float h) : w(w), h(h) {}
+  float area_impl() const { return w * h; }
+  void scale_impl(float k) { w *= k; h *= k; }
+  float w, h;
+};
+struct triangle : shape<triangle> {
+  triangle(float b, float h) : b(b), h(h) {}
+  float area_impl() const { return 0.5f * b * h; }
+  void scale_impl(float k) { b *= k; h *= k; }
+  float b, h;
+};
+/* 模板参数写错时无法构造：shape<circle>() 是私有的，只有 circle 是它的友元
+ * struct oops : shape<circle> { float area_impl() const { return 0; } void scale_impl(float) {} };
+ * oops o;  // error: 'shape<Derived>::shape() [with Derived = circle]' is private within this context
+ */
+
+using any_shape = std::variant<circle, square, rect, triangle>;
+using shapes = closed_hierarchy<circle, square, rect, triangle>;
+
+constexpr std::size_t kObjects = 10000000;
+
+/* 所有版本使用同一个随机序列 */
+template<typename Make>
+void generate(Make make) {
+  std::uint32_t x = 2463534242u;
+  for(std::size_t i = 0; i < kObjects; ++i) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    float a = static_cast<float>(x >> 24) / 64 + 1, b = static_cast<float>((x >> 16) & 0xff) / 64 + 1;
+    make(x & 3, a, b);
+  }
+}
+
+using ms = std::chrono::duration<double, std::milli>;
+
+/* 重复 3 次取最快的一次 */
+template<typename F>
+void bench(const char *name, F f) {
+  double best = 1e300, sum = 0;
+  for(int round = 0; round < 3; ++round) {
+    auto t0 = std::chrono::steady_clock::now();
+    sum = f();
+    best = std::min(best, ms(std::chrono::steady_clock::now() - t0).count());
+  }
+  std::cout << "  " << std::left << std::setw(34) << name << std::right << std::fixed << std::setprecision(1)
+            << std::setw(8) << best << " ms   " << std::setw(6) << std::setprecision(2) << best * 1e6 / kObjects
+            << " ns/obj   sum " << std::setprecision(0) << sum << "\n";
+  std::cout.unsetf(std::ios::fixed);
+}
+
+int main() {
+  circle c(1);
+  c.scale(2);
+  std::cout << "doubled_area(circle(2)) = " << doubled_area(c) << "\n";
+  std::cout << "sizeof: circle_v " << sizeof(circle_v) << ", circle " << sizeof(circle) << ", any_shape "
+            << sizeof(any_shape) << "\n\n";
+
+  std::cout << kObjects << " shapes, 4 types in random order, sum of areas:\n";
+  {
+    std::vector<std::unique_ptr<shape_base>> objs;
+    objs.reserve(kObjects);
+    generate([&](unsigned k, float a, float b) {
+      switch(k) {
+        case 0: objs.push_back(std::make_unique<circle_v>(a)); break;
+        case 1: objs.push_back(std::make_unique<square_v>(a)); break;
+        case 2: objs.push_back(std::make_unique<rect_v>(a, b)); break;
+        default: objs.push_back(std::make_unique<triangle_v>(a, b)); break;
+      }
+    });
+    bench("virtual, random order", [&] {
+      double s = 0;
+      for(auto &p : objs)
+        s += p->area();
+      return s;
+    });
+    /* 按动态类型排序后间接跳转变得可以预测，但对象在堆上的访问顺序被打乱了 */
+    std::stable_sort(objs.begin(), objs.end(), [](const auto &a, const auto &b) {
+      return std::type_index(typeid(*a)) < std::type_index(typeid(*b));
+    });
+    bench("virtual, sorted by type", [&] {
+      double s = 0;
+      for(auto &p : objs)
+        s += p->area();
+      return s;
+    });
+  }
+  {
+    std::vector<circle_v> cs;
+    std::vector<square_v> ss;
+    std::vector<rect_v> rs;
+    std::vector<triangle_v> ts;
+    generate([&](unsigned k, float a, float b) {
+      switch(k) {
+        case 0: cs.emplace_back(a); break;
+        case 1: ss.emplace_back(a); break;
+        case 2: rs.emplace_back(a, b); break;
+        default: ts.emplace_back(a, b); break;
+      }
+    });
+    /* 同样连续存放、按类型分组的对象，通过基类指针调用：间接调用都能预测，但不能内联 */
+    std::vector<const shape_base*> ptrs;
+    ptrs.reserve(kObjects);
+    auto collect = [&ptrs](const auto &v) {
+      for(const auto &x : v)
+        ptrs.push_back(&x);
+    };
+    collect(cs), collect(ss), collect(rs), collect(ts);
+    bench("virtual, grouped contiguous", [&] {
+      double s = 0;
+      for(const shape_base *p : ptrs)
+        s += p->area();
+      return s;
+    });
+    /* 静态类型是 final 类，编译器直接调用并内联 */
+    bench("final, grouped (devirtualized)", [&] {
+      double s = 0;
+      auto sum = [&s](const auto &v) {
+        for(const auto &x : v)
+          s += x.area();
+      };
+      sum(cs), sum(ss), sum(rs), sum(ts);
+      return s;
+    });
+  }
+  {
+    std::vector<any_shape> objs;
+    objs.reserve(kObjects);
+    generate([&](unsigned k, float a, float b) {
+      switch(k) {
+        case 0: objs.emplace_back(circle(a)); break;
+        case 1: objs.emplace_back(square(a)); break;
+        case 2: objs.emplace_back(rect(a, b)); break;
+        default: objs.emplace_back(triangle(a, b)); break;
+      }
+    });
+    bench("std::variant + std::visit", [&] {
+      double s = 0;
+      for(auto &v : objs)
+        s += std::visit([](const auto &x) { return x.area(); }, v);
+      return s;
+    });
+
+    shapes batched;
+    auto t0 = std::chrono::steady_clock::now();
+    batched.assign(objs);
+    std::cout << "  (grouping " << batched.size() << " variants by type took " << std::fixed << std::setprecision(1)
+              << ms(std::chrono::steady_clock::now() - t0).count() << " ms)\n";
+    std::cout.unsetf(std::ios::fixed);
+    bench("CRTP + closed_hierarchy", [&] {
+      return batched.reduce(0.0, [](const auto &x) { return x.area(); });
+    });
+    batched.for_each([](auto &x) { x.scale(0.5f); });
+    bench("CRTP + closed_hierarchy (scaled)", [&] {
+      return batched.reduce(0.0, [](const auto &x) { return x.area(); });
+    });
+  }
+}
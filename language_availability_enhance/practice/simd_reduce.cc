@@ -0,0 +1,438 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/**
+ * @brief 向量化的归约
+ * fold_expression.cc 中的 avg() 和 variable_length_template.cc 中的 sum() 在编译期展开参数包，
+ * 适合几个参数的情况；真正的数据是几百万个元素的数组，这里提供对数组做归约的 sum / mean / min / max / dot / count_if
+ *
+ * 1. 每个算法只写一份，用 GCC 的向量扩展（vector_size）表达，分别在 target("sse2")、target("avx2,fma")、
+ *    target("avx512f") 的入口函数中内联展开，得到三份使用 xmm / ymm / zmm 寄存器的实现，外加一份标量实现
+ * 2. 第一次调用时用 cpuid（__builtin_cpu_supports）选择当前 CPU 支持的最宽的实现，之后通过函数指针表分发
+ * 3. 浮点加法不满足结合律，不同的归约顺序结果会有细微差别：
+ *    - order::fast：每种指令集使用 4 组独立的累加器来隐藏加法的延迟，dot 使用 FMA，结果与指令集有关
+ *    - order::fixed：无论哪种指令集都使用 16 个通道，第 i 个元素总是加到第 i % 16 个通道，最后按固定的二叉树合并，
+ *      并且关闭 FMA 收缩，所以在任何机器、任何指令集下结果都逐位相同
+ * 4. min / max / count_if 的结果与顺序无关，不区分两种模式
+ */
+namespace simd {
+
+enum class isa { scalar, sse2, avx2, avx512 };
+enum class order { fast, fixed };
+
+inline const char* isa_name(isa i) {
+  switch(i) {
+    case isa::sse2: return "sse2";
+    case isa::avx2: return "avx2";
+    case isa::avx512: return "avx512";
+    default: return "scalar";
+  }
+}
+
+/* C++17 中还没有 std::span，这里只需要一个只读的视图 */
+struct fspan {
+  const float *data;
+  std::size_t size;
+  fspan(const float *p, std::size_t n) : data(p), size(n) {}
+  fspan(const std::vector<float> &v) : data(v.data()), size(v.size()) {}
+};
+
+namespace detail {
+
+#define SIMD_INLINE inline __attribute__((always_inline))
+
+/**
+ * 下面的辅助函数总是内联到带 target 的入口函数中，不存在按值传递向量的调用约定问题，
+ * 但 GCC 仍然会对按值传递或者返回 32 / 64 字节向量的函数给出 -Wpsabi 警告；模板函数体在翻译单元末尾才生成，
+ * 用 pragma 包住这一段也关不掉，所以这里的辅助函数一律通过引用传入向量、通过引用写出结果
+ */
+
+typedef float v4sf __attribute__((vector_size(16)));
+typedef float v8sf __attribute__((vector_size(32)));
+typedef float v16sf __attribute__((vector_size(64)));
+
+/* 标量实现把 float 当作只有一个通道的向量 */
+template<typename V>
+constexpr int kWidth = sizeof(V) / sizeof(float);
+
+/* fixed 模式下所有实现共同使用的通道数 */
+constexpr int kFixedLanes = 16;
+
+template<typename V>
+SIMD_INLINE void load(V &out, const float *p) {
+  std::memcpy(&out, p, sizeof(out));
+}
+
+template<typename V>
+SIMD_INLINE void broadcast(V &out, float x) {
+  if constexpr(kWidth<V> == 1)
+    out = x;
+  else
+    out = x - V{};  // 标量与向量运算时标量被广播到每个通道
+}
+
+/* 合并运算：acc = acc op x */
+struct plus_op {
+  template<typename T> SIMD_INLINE void operator()(T &acc, const T &x) const { acc = acc + x; }
+};
+struct min_op {
+  template<typename T> SIMD_INLINE void operator()(T &acc, const T &x) const { acc = acc < x ? acc : x; }
+};
+struct max_op {
+  template<typename T> SIMD_INLINE void operator()(T &acc, const T &x) const { acc = acc > x ? acc : x; }
+};
+
+/**
+ * @brief 通用的归约
+ * R 个宽度为 W 的累加器，每轮处理 R * W 个元素，第 r 个累加器的第 j 个通道负责这一轮中第 r * W + j 个元素
+ * term(v, i) 写出从第 i 个元素开始的一个向量，op 是合并运算
+ * 结束后把 R * W 个通道按二叉树两两合并，再按顺序处理剩下不足一轮的元素
+ */
+template<typename V, int R, typename Term, typename Op>
+SIMD_INLINE float reduce(std::size_t n, float init, Term term, Op op) {
+  constexpr int W = kWidth<V>;
+  constexpr int kLanes = R * W;
+  V acc[R];
+#pragma GCC unroll 16
+  for(int r = 0; r < R; ++r)
+    broadcast(acc[r], init);
+
+  /* 展开之后每个累加器都是一个独立的寄存器 */
+  std::size_t i = 0;
+  for(; i + kLanes <= n; i += kLanes) {
+#pragma GCC unroll 16
+    for(int r = 0; r < R; ++r) {
+      V v;
+      term(v, i + r * W);
+      op(acc[r], v);
+    }
+  }
+
+  float lane[kLanes];
+  std::memcpy(lane, acc, sizeof(lane));
+  for(int w = kLanes / 2; w >= 1; w /= 2)
+    for(int j = 0; j < w; ++j)
+      op(lane[j], lane[j + w]);
+
+  float result = lane[0];
+  for(; i < n; ++i)
+    op(result, term.scalar(i));
+  return result;
+}
+
+/* term：单个数组 */
+template<typename V>
+struct load_term {
+  const float *p;
+  SIMD_INLINE void operator()(V &out, std::size_t i) const { load(out, p + i); }
+  SIMD_INLINE float scalar(std::size_t i) const { return p[i]; }
+};
+
+/* term：两个数组对应元素的乘积 */
+template<typename V>
+struct product_term {
+  const float *a, *b;
+  SIMD_INLINE void operator()(V &out, std::size_t i) const {
+    V y;
+    load(out, a + i);
+    load(y, b + i);
+    out = out * y;
+  }
+  SIMD_INLINE float scalar(std::size_t i) const { return a[i] * b[i]; }
+};
+
+template<typename V, typename Pred>
+SIMD_INLINE std::size_t count_if(const float *p, std::size_t n, Pred pred) {
+  constexpr int W = kWidth<V>;
+  std::size_t i = 0, count = 0;
+  if constexpr(W > 1) {
+    /* 比较的结果是每个通道为 -1 或 0 的整数向量 */
+    using M = decltype(V{} < V{});
+    M acc = {};
+    for(; i + W <= n; i += W) {
+      V v;
+      M m;
+      load(v, p + i);
+      pred(m, v);
+      acc -= m;
+    }
+    for(int j = 0; j < W; ++j)
+      count += static_cast<std::uint32_t>(acc[j]);
+  }
+  for(; i < n; ++i)
+    count += pred(p[i]) ? 1 : 0;
+  return count;
+}
+
+constexpr float kInf = std::numeric_limits<float>::infinity();
+
+/**
+ * 每种指令集的入口函数，TARGET 为空表示使用编译时的默认指令集
+ * FAST_R 是 fast 模式下的累加器个数，fixed 模式下累加器个数为 16 / 宽度
+ */
+#define SIMD_DEFINE_KERNELS(NAME, V, FAST_R, TARGET)                                           \
+  struct NAME {                                                                               \
+    TARGET static float sum(const float *p, std::size_t n) {                                  \
+      return reduce<V, FAST_R>(n, 0.0f, load_term<V>{p}, plus_op{});                          \
+    }                                                                                         \
+    TARGET static float dot(const float *a, const float *b, std::size_t n) {                  \
+      return reduce<V, FAST_R>(n, 0.0f, product_term<V>{a, b}, plus_op{});                    \
+    }                                                                                         \
+    TARGET static float min(const float *p, std::size_t n) {                                  \
+      return reduce<V, FAST_R>(n, kInf, load_term<V>{p}, min_op{});                           \
+    }                                                                                         \
+    TARGET static float max(const float *p, std::size_t n) {                                  \
+      return reduce<V, FAST_R>(n, -kInf, load_term<V>{p}, max_op{});                          \
+    }                                                                                         \
+    template<typename Pred>                                                                   \
+    TARGET static std::size_t count(const float *p, std::size_t n, Pred pred) {               \
+      return detail::count_if<V>(p, n, pred);                                                 \
+    }                                                                                         \
+  };
+
+#define SIMD_DEFINE_FIXED_KERNELS(NAME, V, TARGET)                                             \
+  struct NAME {                                                                               \
+    TARGET static float sum(const float *p, std::size_t n) {                                  \
+      return reduce<V, kFixedLanes / kWidth<V>>(n, 0.0f, load_term<V>{p}, plus_op{});          \
+    }                                                                                         \
+    TARGET static float dot(const float *a, const float *b, std::size_t n) {                  \
+      return reduce<V, kFixedLanes / kWidth<V>>(n, 0.0f, product_term<V>{a, b}, plus_op{});    \
+    }                                                                                         \
+  };
+
+/* 标量实现关掉自动向量化，否则 GCC 会把它也编译成 SSE 代码，基准中的 scalar 就不再是标量 */
+#define SIMD_SCALAR __attribute__((optimize("no-tree-vectorize")))
+SIMD_DEFINE_KERNELS(scalar_kernels, float, 4, SIMD_SCALAR)
+
+/* fixed 模式：关闭 a * b + c 到 FMA 的收缩，保证每种实现的舍入完全相同 */
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+SIMD_DEFINE_FIXED_KERNELS(scalar_fixed, float, SIMD_SCALAR)
+#pragma GCC pop_options
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86 1
+SIMD_DEFINE_KERNELS(sse2_kernels, v4sf, 4, __attribute__((target("sse2"))))
+SIMD_DEFINE_KERNELS(avx2_kernels, v8sf, 4, __attribute__((target("avx2,fma"))))
+SIMD_DEFINE_KERNELS(avx512_kernels, v16sf, 4, __attribute__((target("avx512f"))))
+
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+SIMD_DEFINE_FIXED_KERNELS(sse2_fixed, v4sf, __attribute__((target("sse2"))))
+SIMD_DEFINE_FIXED_KERNELS(avx2_fixed, v8sf, __attribute__((target("avx2"))))
+SIMD_DEFINE_FIXED_KERNELS(avx512_fixed, v16sf, __attribute__((target("avx512f"))))
+#pragma GCC pop_options
+#endif
+
+struct kernel_table {
+  float (*sum[2])(const float*, std::size_t);  // 下标为 order
+  float (*dot[2])(const float*, const float*, std::size_t);
+  float (*min)(const float*, std::size_t);
+  float (*max)(const float*, std::size_t);
+};
+
+template<typename K, typename F>
+constexpr kernel_table make_table() {
+  return {{K::sum, F::sum}, {K::dot, F::dot}, K::min, K::max};
+}
+
+inline bool supported(isa i) {
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  switch(i) {
+    case isa::sse2: return __builtin_cpu_supports("sse2");
+    case isa::avx2: return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case isa::avx512: return __builtin_cpu_supports("avx512f");
+    default: return true;
+  }
+#else
+  return i == isa::scalar;
+#endif
+}
+
+inline isa detect() {
+  for(isa i : {isa::avx512, isa::avx2, isa::sse2})
+    if(supported(i))
+      return i;
+  return isa::scalar;
+}
+
+struct dispatch {
+  isa current;
+  kernel_table table;
+};
+
+inline kernel_table table_for(isa i) {
+  switch(i) {
+#ifdef SIMD_X86
+    case isa::sse2: return make_table<sse2_kernels, sse2_fixed>();
+    case isa::avx2: return make_table<avx2_kernels, avx2_fixed>();
+    case isa::avx512: return make_table<avx512_kernels, avx512_fixed>();
+#endif
+    default: return make_table<scalar_kernels, scalar_fixed>();
+  }
+}
+
+/* 第一次使用时检测一次 */
+inline dispatch &active() {
+  static dispatch d = [] {
+    isa i = detect();
+    return dispatch{i, table_for(i)};
+  }();
+  return d;
+}
+
+}  // namespace detail
+
+inline isa current_isa() { return detail::active().current; }
+inline bool supported(isa i) { return detail::supported(i); }
+
+/* 强制使用某种实现（用于测试和对比），CPU 不支持时返回 false 并保持不变 */
+inline bool set_isa(isa i) {
+  if(!detail::supported(i))
+    return false;
+  detail::active() = {i, detail::table_for(i)};
+  return true;
+}
+
+inline float sum(fspan s, order o = order::fast) {
+  return detail::active().table.sum[static_cast<int>(o)](s.data, s.size);
+}
+
+inline double mean(fspan s, order o = order::fast) {
+  return s.size == 0 ? 0.0 : static_cast<double>(sum(s, o)) / static_cast<double>(s.size);
+}
+
+/* 空数组的 min 为 +inf，max 为 -inf */
+inline float min(fspan s) { return detail::active().table.min(s.data, s.size); }
+inline float max(fspan s) { return detail::active().table.max(s.data, s.size); }
+
+inline float dot(fspan a, fspan b, order o = order::fast) {
+  return detail::active().table.dot[static_cast<int>(o)](a.data, b.data, std::min(a.size, b.size));
+}
+
+/**
+ * count_if 的谓词有两种调用方式：pred(x) 对一个 float 返回 bool；pred(mask, v) 对一个向量写出每个通道为 -1 / 0 的掩码
+ * 和上面的辅助函数一样，向量通过引用传递，不会有 -Wpsabi 警告
+ */
+struct greater {
+  float c;
+  bool operator()(float x) const { return x > c; }
+  template<typename M, typename V> void operator()(M &mask, const V &x) const { mask = x > c; }
+};
+struct less {
+  float c;
+  bool operator()(float x) const { return x < c; }
+  template<typename M, typename V> void operator()(M &mask, const V &x) const { mask = x < c; }
+};
+
+/**
+ * pred 需要支持上面的两种调用方式，例如 simd::greater{0.5f}
+ * 模版无法放进函数指针表，这里按当前的指令集分支
+ */
+template<typename Pred>
+std::size_t count_if(fspan s, Pred pred) {
+  switch(current_isa()) {
+#ifdef SIMD_X86
+    case isa::sse2: return detail::sse2_kernels::count(s.data, s.size, pred);
+    case isa::avx2: return detail::avx2_kernels::count(s.data, s.size, pred);
+    case isa::avx512: return detail::avx512_kernels::count(s.data, s.size, pred);
+#endif
+    default: return detail::scalar_kernels::count(s.data, s.size, pred);
+  }
+}
+
+}  // namespace simd
+
+using sec = std::chrono::duration<double>;
+
+template<typename F>
+void bench(const char *name, std::size_t bytes, F f) {
+  constexpr int kRepeat = 20;
+  double best = 1e30;
+  volatile double sink = 0;
+  for(int r = 0; r < kRepeat; ++r) {
+    auto t0 = std::chrono::steady_clock::now();
+    sink = sink + f();
+    auto t1 = std::chrono::steady_clock::now();
+    best = std::min(best, sec(t1 - t0).count());
+  }
+  std::cout << "  " << name << ": " << bytes / best / 1e9 << " GB/s\n";
+}
+
+int main() {
+  std::cout << "detected: " << simd::isa_name(simd::current_isa()) << "\n";
+
+  std::vector<float> small{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  std::cout << "mean(1..10) = " << simd::mean(small) << ", min = " << simd::min(small)
+            << ", max = " << simd::max(small)
+            << ", count > 5 = " << simd::count_if(small, simd::greater{5.0f}) << "\n";
+
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+  const simd::isa all[] = {simd::isa::scalar, simd::isa::sse2, simd::isa::avx2, simd::isa::avx512};
+
+  /* fixed 模式下各实现的结果必须逐位相同 */
+  {
+    std::vector<float> a(1000003), b(a.size());
+    for(std::size_t i = 0; i < a.size(); ++i) {
+      a[i] = dist(rng);
+      b[i] = dist(rng);
+    }
+    bool identical = true;
+    float ref_sum = 0, ref_dot = 0;
+    bool first = true;
+    for(simd::isa i : all) {
+      if(!simd::set_isa(i))
+        continue;
+      float s = simd::sum(a, simd::order::fixed), d = simd::dot(a, b, simd::order::fixed);
+      std::cout << "  " << simd::isa_name(i) << ": fixed sum " << s << " dot " << d
+                << ", fast sum " << simd::sum(a) << " dot " << simd::dot(a, b) << "\n";
+      if(first) {
+        ref_sum = s;
+        ref_dot = d;
+        first = false;
+      } else if(std::memcmp(&s, &ref_sum, sizeof(s)) != 0 || std::memcmp(&d, &ref_dot, sizeof(d)) != 0) {
+        identical = false;
+      }
+    }
+    std::cout << "fixed-order results bitwise identical across ISAs: " << std::boolalpha << identical << "\n";
+  }
+
+  /* 放得进 L2 的数组衡量计算吞吐，64 MiB 的数组衡量内存带宽 */
+  for(std::size_t n : {std::size_t{64} << 10, std::size_t{16} << 20}) {
+    std::vector<float> a(n), b(n);
+    for(std::size_t i = 0; i < n; ++i) {
+      a[i] = dist(rng);
+      b[i] = dist(rng);
+    }
+    const std::size_t bytes = n * sizeof(float);
+    std::cout << n * sizeof(float) / 1024 << " KiB per array:\n";
+    bench("std::accumulate            ", bytes, [&] { return std::accumulate(a.begin(), a.end(), 0.0f); });
+    bench("std::inner_product (dot)   ", 2 * bytes, [&] { return std::inner_product(a.begin(), a.end(), b.begin(), 0.0f); });
+    bench("std::min_element           ", bytes, [&] { return *std::min_element(a.begin(), a.end()); });
+    for(simd::isa i : all) {
+      if(!simd::set_isa(i))
+        continue;
+      std::string name = simd::isa_name(i);
+      name.resize(7, ' ');
+      bench((name + " sum (fast)          ").c_str(), bytes, [&] { return simd::sum(a); });
+      bench((name + " sum (fixed)         ").c_str(), bytes, [&] { return simd::sum(a, simd::order::fixed); });
+      bench((name + " dot (fast)          ").c_str(), 2 * bytes, [&] { return simd::dot(a, b); });
+      bench((name + " min                 ").c_str(), bytes, [&] { return simd::min(a); });
+      bench((name + " count_if(x > 0.5)   ").c_str(), bytes,
+            [&] { return static_cast<double>(simd::count_if(a, simd::greater{0.5f})); });
+    }
+    simd::set_isa(simd::detail::detect());
+  }
+}
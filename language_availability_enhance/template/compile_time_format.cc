@@ -0,0 +1,386 @@
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#if __has_include(<format>)
+#include <format>
+#endif
+
+/**
+ * @brief 编译期解析格式串的格式化输出
+ * variable_length_template.cc 中的 print1 / print2 / print3 逐个参数地写 std::cout：
+ * 每次 << 都要经过 locale、sentry 和同步的检查，数字的转换也要经过 num_put facet
+ *
+ * 这里的 cfmt::print(CFMT("x = {}, y = {:.2f}\n"), x, y)：
+ * 1. 格式串在编译期被解析成若干段（字面量或参数），占位符个数和参数个数不一致、格式说明不合法、
+ *    格式说明和参数的型别不匹配（{:x} 用于非整数、{:.2f} 用于非浮点数）都是编译错误
+ * 2. 运行期只按顺序追加每一段，整数和浮点数用 std::to_chars 直接写进缓冲区，与 locale 无关
+ * 3. 缓冲区先使用栈上的空间，不够时才增长到堆上，整条消息用一次 write() 输出
+ *
+ * 支持的占位符：{}，{:x}（整数十六进制），{:.N} 或 {:.Nf}（浮点数保留 N 位小数），{{ 和 }} 表示字面的花括号
+ *
+ * C++17 中字符串字面量不能作为模版参数，CFMT 宏把它包装成一个局部型别，用 constexpr 静态成员函数返回这个字符串
+ */
+namespace cfmt {
+
+/* ------------------------------ 缓冲区 ------------------------------ */
+template<std::size_t Inline = 256>
+class basic_buffer {
+public:
+  basic_buffer() noexcept : ptr(stack), len(0), cap(Inline) {}
+  basic_buffer(const basic_buffer&) = delete;
+  basic_buffer& operator=(const basic_buffer&) = delete;
+
+  const char* data() const noexcept { return ptr; }
+  std::size_t size() const noexcept { return len; }
+  void clear() noexcept { len = 0; }
+  std::string_view view() const noexcept { return {ptr, len}; }
+
+  /* 返回至少可以写 n 个字节的位置，写完之后调用 commit */
+  char* reserve(std::size_t n) {
+    if(len + n > cap)
+      grow(len + n);
+    return ptr + len;
+  }
+  void commit(std::size_t n) noexcept { len += n; }
+
+  void append(const char *s, std::size_t n) {
+    std::memcpy(reserve(n), s, n);
+    len += n;
+  }
+  void push_back(char c) {
+    *reserve(1) = c;
+    ++len;
+  }
+
+private:
+  void grow(std::size_t need) {
+    std::size_t new_cap = cap * 2 > need ? cap * 2 : need;
+    std::unique_ptr<char[]> p(new char[new_cap]);
+    std::memcpy(p.get(), ptr, len);
+    heap = std::move(p);
+    ptr = heap.get();
+    cap = new_cap;
+  }
+
+  char stack[Inline];
+  char *ptr;
+  std::size_t len;
+  std::size_t cap;
+  std::unique_ptr<char[]> heap;
+};
+
+using buffer = basic_buffer<>;
+
+/* ------------------------------ 编译期解析 ------------------------------ */
+enum class spec : char { none, hex, fixed };
+
+struct segment {
+  bool is_arg;
+  std::size_t begin, len;  // 字面量在格式串中的位置
+  spec kind;
+  int precision;
+  std::size_t arg;         // 第几个参数
+};
+
+/* 不是 constexpr 的函数，在常量求值中被调用就会产生编译错误，错误信息中会出现这个函数名 */
+inline void format_string_error(const char*) {}
+
+/* 第一遍：数出段数；第二遍：填充。两遍共用同一个解析循环 */
+template<typename Out>
+constexpr std::size_t scan(std::string_view f, Out out) {
+  std::size_t n = 0, args = 0, lit = 0;
+  auto flush_literal = [&](std::size_t end) {
+    if(end > lit)
+      out(n++, segment{false, lit, end - lit, spec::none, 0, 0});
+  };
+  for(std::size_t i = 0; i < f.size(); ++i) {
+    if(f[i] == '{') {
+      if(i + 1 < f.size() && f[i + 1] == '{') {  // {{ 输出一个 {
+        flush_literal(i + 1);
+        lit = ++i + 1;
+        continue;
+      }
+      flush_literal(i);
+      std::size_t close = f.find('}', i);
+      if(close == std::string_view::npos)
+        format_string_error("unmatched '{'");
+      std::string_view s = f.substr(i + 1, close - i - 1);
+      segment seg{true, 0, 0, spec::none, 0, args++};
+      if(s == ":x") {
+        seg.kind = spec::hex;
+      } else if(s.size() >= 3 && s[0] == ':' && s[1] == '.') {
+        seg.kind = spec::fixed;
+        if(s.back() == 'f')
+          s.remove_suffix(1);
+        if(s.size() == 2)
+          format_string_error("missing precision");
+        for(std::size_t k = 2; k < s.size(); ++k) {
+          if(s[k] < '0' || s[k] > '9')
+            format_string_error("invalid precision");
+          seg.precision = seg.precision * 10 + (s[k] - '0');
+        }
+      } else if(!s.empty()) {
+        format_string_error("unsupported format spec");
+      }
+      out(n++, seg);
+      i = close;
+      lit = close + 1;
+    } else if(f[i] == '}') {
+      if(i + 1 >= f.size() || f[i + 1] != '}')
+        format_string_error("unmatched '}'");
+      flush_literal(i + 1);
+      lit = ++i + 1;
+    }
+  }
+  flush_literal(f.size());
+  return n;
+}
+
+template<typename Fmt>
+struct parsed {
+  static constexpr std::string_view str = Fmt::value();
+  static constexpr std::size_t count = scan(str, [](std::size_t, segment) {});
+
+  struct table { segment seg[count > 0 ? count : 1]; };
+  static constexpr table segments = [] {
+    table t{};
+    scan(str, [&](std::size_t i, segment s) { t.seg[i] = s; });
+    return t;
+  }();
+
+  static constexpr std::size_t args = [] {
+    std::size_t n = 0;
+    for(std::size_t i = 0; i < count; ++i)
+      n += segments.seg[i].is_arg;
+    return n;
+  }();
+};
+
+/* ------------------------------ 格式说明与参数型别 ------------------------------ */
+enum class spec_error { none, hex_needs_integer, precision_needs_float };
+
+template<typename T>
+constexpr bool is_integer_arg = std::is_integral<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value;
+
+/* 与参数个数的检查一起在编译期进行，每个带格式说明的占位符检查它对应的参数型别 */
+template<typename P, typename... Args>
+constexpr spec_error check_specs() {
+  constexpr bool integer[] = {is_integer_arg<Args>..., false};
+  constexpr bool floating[] = {std::is_floating_point<Args>::value..., false};
+  for(std::size_t i = 0; i < P::count; ++i) {
+    const segment &s = P::segments.seg[i];
+    if(!s.is_arg || s.arg >= sizeof...(Args))
+      continue;
+    if(s.kind == spec::hex && !integer[s.arg])
+      return spec_error::hex_needs_integer;
+    if(s.kind == spec::fixed && !floating[s.arg])
+      return spec_error::precision_needs_float;
+  }
+  return spec_error::none;
+}
+
+/* ------------------------------ 参数的输出 ------------------------------ */
+template<std::size_t N, typename T>
+void write_integer(basic_buffer<N> &buf, T v, spec kind) {
+  char *p = buf.reserve(24);
+  auto r = std::to_chars(p, p + 24, v, kind == spec::hex ? 16 : 10);
+  buf.commit(r.ptr - p);
+}
+
+template<std::size_t N, typename T>
+void write_float(basic_buffer<N> &buf, T v, spec kind, int precision) {
+  /* 很大的数用定点格式可能很长，空间不够时扩大再试 */
+  for(std::size_t room = 32;; room *= 4) {
+    char *p = buf.reserve(room);
+    auto r = kind == spec::fixed ? std::to_chars(p, p + room, v, std::chars_format::fixed, precision)
+                                 : std::to_chars(p, p + room, v);
+    if(r.ec == std::errc()) {
+      buf.commit(r.ptr - p);
+      return;
+    }
+  }
+}
+
+template<std::size_t N, typename T>
+void write_arg(basic_buffer<N> &buf, const T &v, const segment &s) {
+  if constexpr(std::is_same<T, bool>::value) {
+    v ? buf.append("true", 4) : buf.append("false", 5);
+  } else if constexpr(std::is_same<T, char>::value) {
+    buf.push_back(v);
+  } else if constexpr(std::is_integral<T>::value) {
+    write_integer(buf, v, s.kind);
+  } else if constexpr(std::is_floating_point<T>::value) {
+    write_float(buf, v, s.kind, s.precision);
+  } else if constexpr(std::is_pointer<T>::value && !std::is_convertible<T, const char*>::value) {
+    buf.append("0x", 2);
+    write_integer(buf, reinterpret_cast<std::uintptr_t>(v), spec::hex);
+  } else {
+    std::string_view sv(v);
+    buf.append(sv.data(), sv.size());
+  }
+}
+
+/* 格式串的每一段在编译期已知，这里展开成一串 append / write_arg 调用 */
+template<typename P, std::size_t I, std::size_t N, typename Tuple>
+void emit_segment(basic_buffer<N> &buf, const Tuple &args) {
+  constexpr segment s = P::segments.seg[I];
+  if constexpr(s.is_arg)
+    write_arg(buf, std::get<s.arg>(args), s);
+  else
+    buf.append(P::str.data() + s.begin, s.len);
+}
+
+template<typename P, std::size_t N, typename Tuple, std::size_t... I>
+void emit(basic_buffer<N> &buf, const Tuple &args, std::index_sequence<I...>) {
+  (emit_segment<P, I>(buf, args), ...);
+}
+
+template<typename Fmt, std::size_t N, typename... Args>
+void format_to(basic_buffer<N> &buf, Fmt, const Args&... args) {
+  using P = parsed<Fmt>;
+  static_assert(P::args == sizeof...(Args), "number of {} placeholders does not match number of arguments");
+  constexpr spec_error err = check_specs<P, Args...>();
+  static_assert(err != spec_error::hex_needs_integer, "{:x} requires an integer argument");
+  static_assert(err != spec_error::precision_needs_float, "{:.N} requires a floating point argument");
+  emit<P>(buf, std::forward_as_tuple(args...), std::make_index_sequence<P::count>{});
+}
+
+template<typename Fmt, typename... Args>
+std::string format(Fmt f, const Args&... args) {
+  buffer buf;
+  format_to(buf, f, args...);
+  return std::string(buf.data(), buf.size());
+}
+
+/* 整条消息一次 write()，只有被信号打断或者部分写入时才会再写 */
+inline void write_all(int fd, const char *p, std::size_t n) {
+  while(n > 0) {
+    ssize_t w = ::write(fd, p, n);
+    if(w < 0) {
+      if(errno == EINTR)
+        continue;
+      return;
+    }
+    p += w;
+    n -= static_cast<std::size_t>(w);
+  }
+}
+
+template<typename Fmt, typename... Args>
+void print(int fd, Fmt f, const Args&... args) {
+  basic_buffer<512> buf;
+  format_to(buf, f, args...);
+  write_all(fd, buf.data(), buf.size());
+}
+
+template<typename Fmt, typename... Args>
+void print(Fmt f, const Args&... args) {
+  print(STDOUT_FILENO, f, args...);
+}
+
+}  // namespace cfmt
+
+#define CFMT(s)                                                               \
+  [] {                                                                        \
+    struct cfmt_string {                                                      \
+      static constexpr std::string_view value() { return s; }                 \
+    };                                                                        \
+    return cfmt_string{};                                                     \
+  }()
+
+/* 与 variable_length_template.cc 中 print2 的输出相同 */
+template<typename T, typename... Ts>
+void print2(T value, Ts... args) {
+  std::cout << value << " ";
+  if constexpr(sizeof...(args) > 0)
+    print2(args...);
+}
+
+using ns = std::chrono::duration<double, std::nano>;
+
+template<typename F>
+void bench(const char *name, F f) {
+  constexpr int kIters = 1000000;
+  auto t0 = std::chrono::steady_clock::now();
+  for(int i = 0; i < kIters; ++i)
+    f(i);
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "  " << name << ": " << ns(t1 - t0).count() / kIters << " ns/line\n";
+}
+
+int main() {
+  print2(1, 2, "321", 1.2);
+  std::cout << std::endl;
+  cfmt::print(CFMT("{} {} {} {}\n"), 1, 2, "321", 1.2);
+  cfmt::print(CFMT("hex {:x}, fixed {:.3f}, {{literal}}, {} {}\n"), 255, 3.14159, true, 'c');
+  // cfmt::print(CFMT("{} {}\n"), 1);  // 编译错误：占位符和参数个数不一致
+  // cfmt::print(CFMT("{:q}\n"), 1);   // 编译错误：不支持的格式说明
+  // cfmt::print(CFMT("{:.2f}\n"), 1);  // 编译错误：{:.N} 需要浮点数
+  // cfmt::print(CFMT("{:x}\n"), 1.5);  // 编译错误：{:x} 需要整数
+  // cfmt::print(CFMT("{:.f}\n"), 1.5); // 编译错误：缺少精度
+  std::cout << cfmt::format(CFMT("user={} id={}"), std::string("alice"), 42) << "\n";
+
+  const std::string user = "alice";
+  const char *action = "login";
+
+  /* 只格式化到内存中 */
+  std::cout << "format only:\n";
+  {
+    std::ostringstream os;
+    bench("std::ostringstream ", [&](int i) {
+      os.str("");
+      os << "user=" << user << " action=" << action << " id=" << i << " latency=" << i * 0.25 << "ms\n";
+    });
+    char line[256];
+    bench("snprintf           ", [&](int i) {
+      std::snprintf(line, sizeof(line), "user=%s action=%s id=%d latency=%gms\n", user.c_str(), action, i, i * 0.25);
+    });
+#ifdef __cpp_lib_format
+    std::string s;
+    bench("std::format_to     ", [&](int i) {
+      s.clear();
+      std::format_to(std::back_inserter(s), "user={} action={} id={} latency={}ms\n", user, action, i, i * 0.25);
+    });
+#endif
+    cfmt::buffer buf;
+    bench("cfmt::format_to    ", [&](int i) {
+      buf.clear();
+      cfmt::format_to(buf, CFMT("user={} action={} id={} latency={}ms\n"), user, action, i, i * 0.25);
+    });
+  }
+
+  /* 每条日志都要立即落到文件描述符上（这里是 /dev/null）：iostream 和 stdio 需要 flush，cfmt 本身就是一次 write() */
+  std::cout << "format + flush each line to /dev/null:\n";
+  {
+    std::ofstream null_stream("/dev/null");
+    bench("iostream + endl    ", [&](int i) {
+      null_stream << "user=" << user << " action=" << action << " id=" << i << " latency=" << i * 0.25 << "ms" << std::endl;
+    });
+    FILE *null_file = std::fopen("/dev/null", "w");
+    bench("fprintf + fflush   ", [&](int i) {
+      std::fprintf(null_file, "user=%s action=%s id=%d latency=%gms\n", user.c_str(), action, i, i * 0.25);
+      std::fflush(null_file);
+    });
+    std::fclose(null_file);
+    int fd = ::open("/dev/null", O_WRONLY);
+    bench("cfmt::print (write)", [&](int i) {
+      cfmt::print(fd, CFMT("user={} action={} id={} latency={}ms\n"), user, action, i, i * 0.25);
+    });
+    ::close(fd);
+  }
+}
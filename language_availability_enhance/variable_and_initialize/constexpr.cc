@@ -10,11 +10,22 @@ constexpr int len_foo_constexpr() {
   return 5;
 }
 
-/* C++11 constexpr 函数不允许使用分支语句 */
+/* C++11 constexpr 函数不允许使用分支语句，只能写成双递归，调用次数随 n 指数增长 */
 constexpr int fibonacci(const int n) {
   return n == 1 || n == 2 ? 1 : fibonacci(n - 1) + fibonacci(n - 2);
 }
 
+/* C++14 可以用循环改写为线性的版本；需要反复查询时见 constexpr_lut.cc 中的编译期查找表 */
+constexpr int fibonacci_14(const int n) {
+  int a = 0, b = 1;
+  for(int i = 0; i < n; ++i) {
+    int t = a + b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
 /**
  * constexpr 修饰的表达式会在编译期成为常量表达式
  * 1. constexpr 函数可以递归
@@ -36,5 +47,6 @@ int main() {
   // char arr_5[len_foo() + 5];         // 非法
   char arr_6[len_foo_constexpr() + 1];  // 合法
 
-  std::cout << fibonacci(10) << std::endl;
+  static_assert(fibonacci(10) == fibonacci_14(10), "");
+  std::cout << fibonacci_14(10) << std::endl;
 }
\ No newline at end of file
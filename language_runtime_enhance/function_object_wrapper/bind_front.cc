@@ -0,0 +1,268 @@
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief 零开销的 bind 替代品
+ * std::bind 返回的 bind 表达式型别很复杂，每次调用都要判断每个参数是不是占位符、是不是 bind 表达式、
+ * 是不是 reference_wrapper，编译器经常内联不干净；再套一层 std::function 就还要付出类型擦除的代价
+ *
+ * 这里提供三个函数，返回的都是普通的闭包对象，编译器可以完全内联：
+ * 1. bind_front(f, args...)：绑定前面的参数，等价于 [=](auto&&... rest) { return f(args..., rest...); }
+ * 2. bind_back(f, args...)：绑定后面的参数
+ * 3. bind(f, args...)：支持 _1, _2, ... 占位符的版本
+ *
+ * 都支持成员函数指针和数据成员指针（第一个参数可以是对象、对象指针、智能指针或者 reference_wrapper，和 std::invoke 相同），
+ * 所有函数都是 constexpr，被绑定的参数按值保存；闭包是右值时，被绑定的参数会被移动给被调用的函数
+ *
+ * C++20 中 std 里也有 bind_front，参数中有 std 的型别时实参依赖查找会同时找到两个版本，所以调用时要写 fast_bind::
+ */
+namespace fast_bind {
+
+/* C++17 中 std::invoke 不是 constexpr，自己实现一个支持成员指针的版本 */
+template<typename M>
+struct member_class {};
+template<typename M, typename C>
+struct member_class<M C::*> { using type = C; };
+
+template<typename T>
+struct is_reference_wrapper : std::false_type {};
+template<typename T>
+struct is_reference_wrapper<std::reference_wrapper<T>> : std::true_type {};
+
+/* 对象本身（或派生类）直接使用，reference_wrapper 取出引用，其余的（裸指针、智能指针）解引用 */
+template<typename C, typename T>
+constexpr decltype(auto) deref(T &&t) {
+  if constexpr(std::is_base_of<C, std::decay_t<T>>::value)
+    return std::forward<T>(t);
+  else if constexpr(is_reference_wrapper<std::decay_t<T>>::value)
+    return t.get();
+  else
+    return *std::forward<T>(t);
+}
+
+template<typename F, typename... Args>
+constexpr decltype(auto) invoke(F &&f, Args&&... args) {
+  if constexpr(std::is_member_function_pointer<std::decay_t<F>>::value) {
+    using C = typename member_class<std::decay_t<F>>::type;
+    return [&](auto &&obj, auto&&... rest) -> decltype(auto) {
+      return (deref<C>(std::forward<decltype(obj)>(obj)).*f)(std::forward<decltype(rest)>(rest)...);
+    }(std::forward<Args>(args)...);
+  } else if constexpr(std::is_member_object_pointer<std::decay_t<F>>::value) {
+    using C = typename member_class<std::decay_t<F>>::type;
+    return [&](auto &&obj) -> decltype(auto) {
+      return (deref<C>(std::forward<decltype(obj)>(obj)).*f);
+    }(std::forward<Args>(args)...);
+  } else {
+    return std::forward<F>(f)(std::forward<Args>(args)...);
+  }
+}
+
+template<bool Front, typename F, typename... Bound>
+class partial {
+public:
+  template<typename G, typename... Ts>
+  constexpr explicit partial(G &&g, Ts&&... ts) : f(std::forward<G>(g)), bound(std::forward<Ts>(ts)...) {}
+
+  /* 按闭包本身的值类别转发被绑定的参数 */
+  template<typename... Us>
+  constexpr decltype(auto) operator()(Us&&... us) & {
+    return call(f, bound, std::index_sequence_for<Bound...>{}, std::forward<Us>(us)...);
+  }
+  template<typename... Us>
+  constexpr decltype(auto) operator()(Us&&... us) const & {
+    return call(f, bound, std::index_sequence_for<Bound...>{}, std::forward<Us>(us)...);
+  }
+  template<typename... Us>
+  constexpr decltype(auto) operator()(Us&&... us) && {
+    return call(std::move(f), std::move(bound), std::index_sequence_for<Bound...>{}, std::forward<Us>(us)...);
+  }
+
+private:
+  template<typename Fn, typename Tuple, std::size_t... I, typename... Us>
+  static constexpr decltype(auto) call(Fn &&fn, Tuple &&t, std::index_sequence<I...>, Us&&... us) {
+    if constexpr(Front)
+      return fast_bind::invoke(std::forward<Fn>(fn), std::get<I>(std::forward<Tuple>(t))..., std::forward<Us>(us)...);
+    else
+      return fast_bind::invoke(std::forward<Fn>(fn), std::forward<Us>(us)..., std::get<I>(std::forward<Tuple>(t))...);
+  }
+
+  F f;
+  std::tuple<Bound...> bound;
+};
+
+template<typename F, typename... Args>
+constexpr auto bind_front(F &&f, Args&&... args) {
+  return partial<true, std::decay_t<F>, std::decay_t<Args>...>(std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+template<typename F, typename... Args>
+constexpr auto bind_back(F &&f, Args&&... args) {
+  return partial<false, std::decay_t<F>, std::decay_t<Args>...>(std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+/* 占位符 _N 选择调用时的第 N 个参数 */
+template<std::size_t N>
+struct placeholder {};
+
+inline constexpr placeholder<1> _1{};
+inline constexpr placeholder<2> _2{};
+inline constexpr placeholder<3> _3{};
+inline constexpr placeholder<4> _4{};
+
+template<typename T>
+struct placeholder_index : std::integral_constant<std::size_t, 0> {};
+template<std::size_t N>
+struct placeholder_index<placeholder<N>> : std::integral_constant<std::size_t, N> {};
+
+/* 占位符取调用时的参数，其余的按 Bound 的值类别转发被绑定的参数 */
+template<typename Bound, typename CallArgs>
+constexpr decltype(auto) select(Bound &&b, CallArgs &&call_args) {
+  constexpr std::size_t N = placeholder_index<std::decay_t<Bound>>::value;
+  if constexpr(N != 0)
+    return std::get<N - 1>(std::forward<CallArgs>(call_args));
+  else
+    return std::forward<Bound>(b);
+}
+
+template<typename F, typename... Bound>
+class binder {
+public:
+  template<typename G, typename... Ts>
+  constexpr explicit binder(G &&g, Ts&&... ts) : f(std::forward<G>(g)), bound(std::forward<Ts>(ts)...) {}
+
+  /* 与 partial 相同，按闭包本身的值类别转发被绑定的参数 */
+  template<typename... Us>
+  constexpr decltype(auto) operator()(Us&&... us) & {
+    return call(f, bound, std::index_sequence_for<Bound...>{}, std::forward_as_tuple(std::forward<Us>(us)...));
+  }
+  template<typename... Us>
+  constexpr decltype(auto) operator()(Us&&... us) const & {
+    return call(f, bound, std::index_sequence_for<Bound...>{}, std::forward_as_tuple(std::forward<Us>(us)...));
+  }
+  template<typename... Us>
+  constexpr decltype(auto) operator()(Us&&... us) && {
+    return call(std::move(f), std::move(bound), std::index_sequence_for<Bound...>{},
+                std::forward_as_tuple(std::forward<Us>(us)...));
+  }
+
+private:
+  template<typename Fn, typename Tuple, std::size_t... I, typename CallArgs>
+  static constexpr decltype(auto) call(Fn &&fn, Tuple &&t, std::index_sequence<I...>, CallArgs &&call_args) {
+    return fast_bind::invoke(std::forward<Fn>(fn), select(std::get<I>(std::forward<Tuple>(t)), std::move(call_args))...);
+  }
+
+  F f;
+  std::tuple<Bound...> bound;
+};
+
+template<typename F, typename... Args>
+constexpr auto bind(F &&f, Args&&... args) {
+  return binder<std::decay_t<F>, std::decay_t<Args>...>(std::forward<F>(f), std::forward<Args>(args)...);
+}
+
+}  // namespace fast_bind
+
+constexpr int foo(int a, int b, int c) {
+  return a + b + c;
+}
+
+/* 与 foo 相同的函数对象，型别本身就决定了调用目标 */
+struct Foo {
+  constexpr int operator()(int a, int b, int c) const { return a + b + c; }
+};
+
+struct Counter {
+  int base = 100;
+  constexpr int add(int v) const { return base + v; }
+};
+
+/**
+ * @brief 生成代码对比
+ * 用 g++ -std=c++17 -O2 -S bind_front.cc 编译之后，
+ * 下面的函数生成的汇编完全相同（都只剩一条 lea），std::bind 在这种最简单的场景下也能被内联
+ *
+ * 注意绑定函数指针时闭包中保存的是一个运行期的指针，只有在编译器能看到它的值时才会被内联；
+ * 下面的 bench 把闭包作为参数传入循环，函数指针版本就只能间接调用，绑定函数对象（Foo{}）则没有这个问题
+ */
+__attribute__((noinline)) int call_lambda(int x) {
+  auto f = [](int a) { return foo(a, 1, 2); };
+  return f(x);
+}
+
+__attribute__((noinline)) int call_fast_bind(int x) {
+  auto f = fast_bind::bind(foo, fast_bind::_1, 1, 2);
+  return f(x);
+}
+
+__attribute__((noinline)) int call_bind_back(int x) {
+  auto f = fast_bind::bind_back(foo, 1, 2);
+  return f(x);
+}
+
+__attribute__((noinline)) int call_std_bind(int x) {
+  auto f = std::bind(foo, std::placeholders::_1, 1, 2);
+  return f(x);
+}
+
+using ns = std::chrono::duration<double, std::nano>;
+
+template<typename F>
+__attribute__((noinline)) void bench(const char *name, F f) {
+  constexpr int kCalls = 100000000;
+  long long sum = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for(int i = 0; i < kCalls; ++i) {
+    asm volatile("" : "+r"(i));
+    sum += f(i);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << name << ": " << ns(t1 - t0).count() / kCalls << " ns/call (" << sum << ")\n";
+}
+
+int main() {
+  using fast_bind::_1;
+  using fast_bind::_2;
+
+  /* 与 std::bind.cc 中相同的用法 */
+  auto bind_foo = fast_bind::bind(foo, _1, 1, 2);
+  std::cout << bind_foo(1) << "\n";
+
+  /* 全部在编译期求值 */
+  static_assert(fast_bind::bind_front(foo, 1)(2, 3) == 6, "");
+  static_assert(fast_bind::bind_back(foo, 1)(2, 3) == 6, "");
+  static_assert(fast_bind::bind(foo, _2, _1, 10)(1, 2) == 13, "");
+  static_assert(fast_bind::bind_front(&Counter::add, Counter{})(1) == 101, "");
+
+  /* 成员函数指针和数据成员指针 */
+  Counter c;
+  std::cout << fast_bind::bind_front(&Counter::add, &c)(5) << " " << fast_bind::bind_front(&Counter::base)(c) << "\n";
+
+  /* 通过智能指针和 reference_wrapper 调用成员，和 std::invoke 相同 */
+  auto owned = std::make_unique<Counter>();
+  std::cout << fast_bind::bind_front(&Counter::add, std::cref(c))(6) << " "
+            << fast_bind::bind(&Counter::add, _1, 7)(owned) << "\n";
+
+  /* 闭包是右值时，被绑定的 string 被移动给被调用的函数 */
+  auto take = fast_bind::bind_front([](std::string s, int n) { return s.size() + n; }, std::string(32, 'x'));
+  std::cout << std::move(take)(1) << "\n";
+
+  /* 只能移动的被绑定参数：只有右值闭包能调用 */
+  auto consume = fast_bind::bind([](std::unique_ptr<int> p, int n) { return *p + n; }, std::make_unique<int>(40), _1);
+  std::cout << std::move(consume)(2) << "\n";
+
+  std::cout << call_lambda(1) << call_fast_bind(1) << call_bind_back(1) << call_std_bind(1) << "\n";
+
+  bench("lambda                 ", [](int a) { return foo(a, 1, 2); });
+  bench("fast_bind::bind(foo)   ", fast_bind::bind(foo, _1, 1, 2));
+  bench("fast_bind::bind(Foo{}) ", fast_bind::bind(Foo{}, _1, 1, 2));
+  bench("fast_bind::bind_back   ", fast_bind::bind_back(Foo{}, 1, 2));
+  bench("std::bind(foo)         ", std::bind(foo, std::placeholders::_1, 1, 2));
+  bench("std::bind(Foo{})       ", std::bind(Foo{}, std::placeholders::_1, 1, 2));
+  bench("std::function(std::bind)", std::function<int(int)>(std::bind(foo, std::placeholders::_1, 1, 2)));
+}
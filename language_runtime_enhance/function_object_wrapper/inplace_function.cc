@@ -0,0 +1,213 @@
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief std::function 的两种替代品
+ * std::function 只有很小的 SBO（libstdc++ 是 16 字节），捕获稍多一点就要堆分配，
+ * 调用时还要经过一次不透明的间接跳转
+ *
+ * 1. inplace_function<Sig, Capacity>：可调用对象总是放在内部 Capacity 字节的缓冲区中，永远不分配内存
+ *    放不下的时候直接编译失败，而不是悄悄退化为堆分配
+ * 2. function_ref<Sig>：不拥有可调用对象，只保存对象地址和一个调用函数指针，两个指针大小
+ *    适合"只在调用期间使用回调"的函数参数，调用方负责保证对象活得足够久
+ */
+template<typename Sig, std::size_t Capacity = 32>
+class inplace_function;
+
+template<typename R, typename... Args, std::size_t Capacity>
+class inplace_function<R(Args...), Capacity> {
+public:
+  inplace_function() noexcept = default;
+  inplace_function(std::nullptr_t) noexcept {}
+
+  template<typename F, typename D = std::decay_t<F>,
+           typename = std::enable_if_t<!std::is_same<D, inplace_function>::value>>
+  inplace_function(F &&f) {
+    static_assert(sizeof(D) <= Capacity, "inplace_function: callable does not fit into Capacity");
+    static_assert(alignof(std::max_align_t) % alignof(D) == 0, "inplace_function: callable is over-aligned");
+    static_assert(std::is_invocable_r<R, D&, Args...>::value, "inplace_function: signature mismatch");
+    new (&storage) D(std::forward<F>(f));
+    vt = &vtable_for<D>;
+  }
+
+  inplace_function(const inplace_function &other) : vt(other.vt) {
+    if(vt)
+      vt->copy(&storage, &other.storage);
+  }
+
+  inplace_function(inplace_function &&other) noexcept : vt(other.vt) {
+    if(vt)
+      vt->move(&storage, &other.storage);
+  }
+
+  inplace_function& operator=(inplace_function other) noexcept {
+    reset();
+    if(other.vt) {
+      other.vt->move(&storage, &other.storage);
+      vt = other.vt;
+    }
+    return *this;
+  }
+
+  ~inplace_function() { reset(); }
+
+  R operator()(Args... args) const {
+    return vt->invoke(const_cast<void*>(static_cast<const void*>(&storage)), std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const noexcept { return vt != nullptr; }
+
+private:
+  struct vtable {
+    R (*invoke)(void*, Args&&...);
+    void (*copy)(void*, const void*);
+    void (*move)(void*, void*) noexcept;
+    void (*destroy)(void*) noexcept;
+  };
+
+  /* 每种可调用对象型别一张静态的函数表 */
+  template<typename D>
+  static constexpr vtable vtable_for = {
+    [](void *p, Args&&... args) -> R { return (*static_cast<D*>(p))(std::forward<Args>(args)...); },
+    [](void *dst, const void *src) { new (dst) D(*static_cast<const D*>(src)); },
+    [](void *dst, void *src) noexcept { new (dst) D(std::move(*static_cast<D*>(src))); },
+    [](void *p) noexcept { static_cast<D*>(p)->~D(); }
+  };
+
+  void reset() noexcept {
+    if(vt) {
+      vt->destroy(&storage);
+      vt = nullptr;
+    }
+  }
+
+  const vtable *vt = nullptr;
+  std::aligned_storage_t<Capacity, alignof(std::max_align_t)> storage;
+};
+
+template<typename Sig>
+class function_ref;
+
+template<typename R, typename... Args>
+class function_ref<R(Args...)> {
+public:
+  template<typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, function_ref>::value &&
+                                                   std::is_invocable_r<R, F&, Args...>::value>>
+  function_ref(F &&f) noexcept
+      : obj(const_cast<void*>(static_cast<const void*>(std::addressof(f)))),
+        call([](void *p, Args... args) -> R {
+          return (*static_cast<std::remove_reference_t<F>*>(p))(std::forward<Args>(args)...);
+        }) {}
+
+  /* 普通函数单独处理，函数指针不能转换为 void* */
+  function_ref(R (*f)(Args...)) noexcept
+      : obj(reinterpret_cast<void*>(f)),
+        call([](void *p, Args... args) -> R {
+          return reinterpret_cast<R (*)(Args...)>(p)(std::forward<Args>(args)...);
+        }) {}
+
+  R operator()(Args... args) const { return call(obj, std::forward<Args>(args)...); }
+
+private:
+  void *obj;
+  R (*call)(void*, Args...);
+};
+
+int foo(int para) {
+  return para;
+}
+
+/* 只在调用期间使用回调，参数用 function_ref 即可 */
+long long apply_n(function_ref<int(int)> f, int n) {
+  long long r = 0;
+  for(int i = 0; i < n; ++i)
+    r += f(i);
+  return r;
+}
+
+/* 捕获 N 字节数据的 lambda，用于比较不同捕获大小下的开销 */
+template<std::size_t N>
+auto make_lambda(int seed) {
+  std::array<int, N / sizeof(int)> data{};
+  data[0] = seed;
+  return [data](int v) { return v + data[0]; };
+}
+
+using ns = std::chrono::duration<double, std::nano>;
+
+/* 让编译器认为 v 被读写过，避免构造和调用被整体优化掉 */
+template<typename T>
+inline void do_not_optimize(T &v) {
+  asm volatile("" : : "r"(&v) : "memory");
+}
+
+/**
+ * @brief construct：每次构造一个包装器并调用一次，包含可能的堆分配和释放
+ * invoke：1024 个包装器放在数组中反复调用，数据留在缓存里，只比较调用本身
+ */
+template<typename Fn, std::size_t N>
+void bench(const char *name) {
+  constexpr int kCount = 1000000;
+  constexpr int kSlots = 1024;
+  constexpr int kRounds = 10000;
+  long long sum = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for(int i = 0; i < kCount; ++i) {
+    Fn f(make_lambda<N>(i));
+    do_not_optimize(f);
+    sum += f(i);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  std::vector<Fn> v;
+  for(int i = 0; i < kSlots; ++i)
+    v.emplace_back(make_lambda<N>(i));
+  do_not_optimize(v);
+  auto t2 = std::chrono::steady_clock::now();
+  for(int round = 0; round < kRounds; ++round)
+    for(auto &f : v)
+      sum += f(round);
+  auto t3 = std::chrono::steady_clock::now();
+  std::cout << "  " << name << ": construct " << ns(t1 - t0).count() / kCount << " ns"
+            << ", invoke " << ns(t3 - t2).count() / kSlots / kRounds << " ns"
+            << " (" << sum << ")\n";
+}
+
+template<std::size_t N>
+void bench_capture() {
+  std::cout << "capture " << N << " bytes:\n";
+  bench<std::function<int(int)>, N>("std::function          ");
+  bench<inplace_function<int(int), 64>, N>("inplace_function<64>   ");
+  /* function_ref 不拥有对象，只比较调用开销 */
+  auto f = make_lambda<N>(1);
+  function_ref<int(int)> ref = f;
+  do_not_optimize(ref);
+  constexpr int kCalls = 10000000;
+  auto t0 = std::chrono::steady_clock::now();
+  long long r = apply_n(ref, kCalls);
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "  function_ref           : invoke " << ns(t1 - t0).count() / kCalls << " ns (" << r << ")\n";
+}
+
+int main() {
+  inplace_function<int(int)> func = foo;
+  int important = 10;
+  inplace_function<int(int)> func2 = [&](int value) -> int {
+    return 1 + value + important;
+  };
+  auto func3 = func2;  // 可以拷贝
+  std::cout << func(10) << " " << func2(10) << " " << func3(10) << "\n";
+  std::cout << apply_n(foo, 4) << " " << apply_n([&](int v) { return v * important; }, 4) << "\n";
+
+  // inplace_function<int(int), 8> too_small = make_lambda<32>(0); // 编译失败，缓冲区放不下
+
+  bench_capture<8>();
+  bench_capture<32>();
+  bench_capture<64>();
+}
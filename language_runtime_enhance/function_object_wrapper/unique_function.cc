@@ -0,0 +1,75 @@
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include "unique_function.h"
+
+/**
+ * @brief unique_function 的使用
+ * variable_capture.cc 中 lambda_expression_capture() 通过表达式捕获移动了一个 unique_ptr，
+ * 这样的闭包只能移动，不能放进 std::function，但是可以放进 unique_function
+ */
+void lambda_expression_capture() {
+  auto important = std::make_unique<int>(1);
+  unique_function<int(int, int)> add = [v1 = 1, v2 = std::move(important)](int x, int y) -> int {
+    return x + y + v1 + (*v2);
+  };
+  // std::function<int(int, int)> f = std::move(add); // 错误，闭包不可拷贝
+  auto moved = std::move(add);
+  std::cout << moved(3, 4) << " " << std::boolalpha << static_cast<bool>(add) << "\n";
+
+  /* std::packaged_task 同样只能移动 */
+  std::packaged_task<int()> task([] { return 7; });
+  auto result = task.get_future();
+  unique_function<void()> job = std::move(task);
+  job();
+  std::cout << "packaged_task result: " << result.get() << "\n";
+}
+
+using ns = std::chrono::duration<double, std::nano>;
+
+/**
+ * @brief 任务队列的吞吐：入队 kTasks 个捕获了 unique_ptr 状态的任务，再依次出队执行
+ * 1. std::function + shared_ptr：为了让闭包可拷贝，把状态转移进 shared_ptr
+ * 2. unique_function：直接移动捕获 unique_ptr
+ */
+int main() {
+  lambda_expression_capture();
+
+  constexpr int kTasks = 2000000;
+  long long sum = 0;
+
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    std::deque<std::function<void()>> q;
+    for(int i = 0; i < kTasks; ++i) {
+      auto state = std::make_unique<int>(i);
+      std::shared_ptr<int> shared = std::move(state);
+      q.emplace_back([shared, &sum] { sum += *shared; });
+    }
+    while(!q.empty()) {
+      q.front()();
+      q.pop_front();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    std::cout << "std::function + shared_ptr: " << ns(t1 - t0).count() / kTasks << " ns/task\n";
+  }
+
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    std::deque<unique_function<void()>> q;
+    for(int i = 0; i < kTasks; ++i) {
+      auto state = std::make_unique<int>(i);
+      q.emplace_back([state = std::move(state), &sum] { sum += *state; });
+    }
+    while(!q.empty()) {
+      q.front()();
+      q.pop_front();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    std::cout << "unique_function:            " << ns(t1 - t0).count() / kTasks << " ns/task\n";
+  }
+  std::cout << "sum = " << sum << "\n";
+}
@@ -0,0 +1,114 @@
+#ifndef UNIQUE_FUNCTION_H
+#define UNIQUE_FUNCTION_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief 只能移动的可调用对象包装器
+ * std::function 要求可调用对象可拷贝，捕获了 unique_ptr 的 lambda、std::packaged_task 都放不进去，
+ * 常见的绕法是把状态包进 shared_ptr，这样多了一次堆分配和原子引用计数
+ *
+ * unique_function<Sig, Capacity>：
+ * 1. 不要求可拷贝，自身也只能移动
+ * 2. 内部有 Capacity 字节的缓冲区，可调用对象放得下并且移动构造不抛异常时放在缓冲区中，否则放到堆上
+ * 3. 移动构造和移动赋值都是 noexcept，放进 std::vector / std::deque 之类的容器时不会退化为拷贝
+ */
+template<typename Sig, std::size_t Capacity = 3 * sizeof(void*)>
+class unique_function;
+
+template<typename R, typename... Args, std::size_t Capacity>
+class unique_function<R(Args...), Capacity> {
+public:
+  unique_function() noexcept = default;
+  unique_function(std::nullptr_t) noexcept {}
+
+  template<typename F, typename D = std::decay_t<F>,
+           typename = std::enable_if_t<!std::is_same<D, unique_function>::value &&
+                                       std::is_invocable_r<R, D&, Args...>::value>>
+  unique_function(F &&f) {
+    if constexpr(fits_inline<D>()) {
+      new (&storage) D(std::forward<F>(f));
+      vt = &inline_vtable<D>;
+    } else {
+      *reinterpret_cast<D**>(&storage) = new D(std::forward<F>(f));
+      vt = &heap_vtable<D>;
+    }
+  }
+
+  unique_function(unique_function &&other) noexcept : vt(other.vt) {
+    if(vt) {
+      vt->move(&storage, &other.storage);
+      other.vt = nullptr;
+    }
+  }
+
+  unique_function& operator=(unique_function &&other) noexcept {
+    if(this != &other) {
+      reset();
+      if(other.vt) {
+        other.vt->move(&storage, &other.storage);
+        vt = std::exchange(other.vt, nullptr);
+      }
+    }
+    return *this;
+  }
+
+  unique_function(const unique_function&) = delete;
+  unique_function& operator=(const unique_function&) = delete;
+
+  ~unique_function() { reset(); }
+
+  R operator()(Args... args) {
+    return vt->invoke(&storage, std::forward<Args>(args)...);
+  }
+
+  explicit operator bool() const noexcept { return vt != nullptr; }
+
+private:
+  struct vtable {
+    R (*invoke)(void*, Args&&...);
+    void (*move)(void*, void*) noexcept;  // 移动到 dst 并销毁 src
+    void (*destroy)(void*) noexcept;
+  };
+
+  template<typename D>
+  static constexpr bool fits_inline() {
+    return sizeof(D) <= Capacity && alignof(std::max_align_t) % alignof(D) == 0 &&
+           std::is_nothrow_move_constructible<D>::value;
+  }
+
+  template<typename D>
+  static constexpr vtable inline_vtable = {
+    [](void *p, Args&&... args) -> R { return (*static_cast<D*>(p))(std::forward<Args>(args)...); },
+    [](void *dst, void *src) noexcept {
+      new (dst) D(std::move(*static_cast<D*>(src)));
+      static_cast<D*>(src)->~D();
+    },
+    [](void *p) noexcept { static_cast<D*>(p)->~D(); }
+  };
+
+  /* 放在堆上时缓冲区里只保存一个指针，移动只需要搬动指针 */
+  template<typename D>
+  static constexpr vtable heap_vtable = {
+    [](void *p, Args&&... args) -> R { return (**static_cast<D**>(p))(std::forward<Args>(args)...); },
+    [](void *dst, void *src) noexcept { *static_cast<D**>(dst) = *static_cast<D**>(src); },
+    [](void *p) noexcept { delete *static_cast<D**>(p); }
+  };
+
+  void reset() noexcept {
+    if(vt) {
+      vt->destroy(&storage);
+      vt = nullptr;
+    }
+  }
+
+  static constexpr std::size_t kStorage = Capacity < sizeof(void*) ? sizeof(void*) : Capacity;
+
+  const vtable *vt = nullptr;
+  std::aligned_storage_t<kStorage, alignof(std::max_align_t)> storage;
+};
+
+#endif
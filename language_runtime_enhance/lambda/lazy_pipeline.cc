@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 惰性、融合的 lambda 流水线
+ * 一步一步地用 lambda 变换 vector（例如 variable_capture.cc 中泛型 lambda add 那样的小函数），
+ * 每一步都会产生一个中间 vector：分配内存、写一遍、下一步再读一遍
+ *
+ * 这里的流水线写成 source(v) | filter(f) | map(g) | take(n) | sink：
+ * 1. 中间的阶段只是把 lambda 记录下来，什么也不做
+ * 2. 遇到 sink 时从后往前把各个阶段组合成一个 "接收一个元素" 的闭包，然后对源数据只跑一个循环
+ *    每个元素依次经过 filter -> map -> take -> sink，全程没有中间缓冲区，编译器可以把整条链内联
+ * 3. take 满了之后闭包返回 false，循环提前结束
+ * 4. par_sum / par_reduce 把源数据切成若干段，每个线程用一份流水线的拷贝处理一段，最后合并
+ *    take 依赖元素的先后顺序，不能用于并行的 sink
+ */
+namespace lazy {
+
+template<typename F>
+struct filter_t {
+  F f;
+  template<typename T> using out = T;
+  template<typename Next>
+  auto wrap(Next next) const {
+    return [f = f, next](auto &&x) mutable -> bool {
+      return f(x) ? next(std::forward<decltype(x)>(x)) : true;
+    };
+  }
+};
+
+template<typename F>
+struct map_t {
+  F f;
+  template<typename T> using out = std::decay_t<std::invoke_result_t<const F&, T>>;
+  template<typename Next>
+  auto wrap(Next next) const {
+    return [f = f, next](auto &&x) mutable -> bool {
+      return next(f(std::forward<decltype(x)>(x)));
+    };
+  }
+};
+
+struct take_t {
+  std::size_t n;
+  template<typename T> using out = T;
+  template<typename Next>
+  auto wrap(Next next) const {
+    return [left = n, next](auto &&x) mutable -> bool {
+      if(left == 0)
+        return false;
+      --left;
+      return next(std::forward<decltype(x)>(x)) && left > 0;
+    };
+  }
+};
+
+template<typename F> filter_t<F> filter(F f) { return {std::move(f)}; }
+template<typename F> map_t<F> map(F f) { return {std::move(f)}; }
+inline take_t take(std::size_t n) { return {n}; }
+
+template<typename It, typename... Stages>
+struct pipeline {
+  It first, last;
+  std::tuple<Stages...> stages;
+
+  /* 把 sink 从后往前依次套上每一个阶段 */
+  template<std::size_t I = 0, typename Sink>
+  auto compose(Sink sink) const {
+    if constexpr(I == sizeof...(Stages))
+      return sink;
+    else
+      return std::get<I>(stages).wrap(compose<I + 1>(std::move(sink)));
+  }
+
+  template<typename Sink>
+  void run(It begin, It end, Sink sink) const {
+    auto chain = compose(std::move(sink));
+    for(; begin != end; ++begin)
+      if(!chain(*begin))
+        break;
+  }
+
+  /* 依次经过每个阶段之后的元素型别 */
+  template<typename T, typename... Ss>
+  struct output { using type = T; };
+  template<typename T, typename S, typename... Ss>
+  struct output<T, S, Ss...> : output<typename S::template out<T>, Ss...> {};
+  using value_type = typename output<std::decay_t<decltype(*std::declval<It>())>, Stages...>::type;
+
+  static constexpr bool has_take = (std::is_same<Stages, take_t>::value || ...);
+};
+
+template<typename Range>
+auto source(const Range &r) {
+  return pipeline<decltype(std::begin(r))>{std::begin(r), std::end(r), {}};
+}
+
+template<typename It, typename... Stages, typename Stage>
+auto operator|(pipeline<It, Stages...> p, Stage s) -> pipeline<It, Stages..., Stage> {
+  return {p.first, p.last, std::tuple_cat(std::move(p.stages), std::make_tuple(std::move(s)))};
+}
+
+/* sink 也通过 | 接到流水线后面 */
+struct sum_t {};
+struct to_vector_t {};
+template<typename F> struct for_each_t { F f; };
+template<typename T, typename Op> struct par_reduce_t { T init; Op op; unsigned threads; };
+
+inline sum_t sum() { return {}; }
+inline to_vector_t to_vector() { return {}; }
+template<typename F> for_each_t<F> for_each(F f) { return {std::move(f)}; }
+template<typename T, typename Op>
+par_reduce_t<T, Op> par_reduce(T init, Op op, unsigned threads = std::thread::hardware_concurrency()) {
+  return {init, op, threads == 0 ? 1 : threads};
+}
+inline auto par_sum(unsigned threads = std::thread::hardware_concurrency()) {
+  return par_reduce(0LL, [](long long a, long long b) { return a + b; }, threads);
+}
+
+/* 累加器的型别：整数至少提升到 long long 以免溢出，浮点数和其它型别保持元素自身的型别 */
+template<typename V>
+using sum_type = typename std::conditional_t<std::is_arithmetic<V>::value,
+                                             std::common_type<V, long long>, std::common_type<V>>::type;
+
+template<typename It, typename... Stages>
+auto operator|(const pipeline<It, Stages...> &p, sum_t) {
+  using T = sum_type<typename pipeline<It, Stages...>::value_type>;
+  T total{};
+  p.run(p.first, p.last, [&](auto &&x) { total += x; return true; });
+  return total;
+}
+
+template<typename It, typename... Stages>
+auto operator|(const pipeline<It, Stages...> &p, to_vector_t) {
+  std::vector<typename pipeline<It, Stages...>::value_type> out;
+  p.run(p.first, p.last, [&](auto &&x) { out.push_back(x); return true; });
+  return out;
+}
+
+template<typename It, typename... Stages, typename F>
+void operator|(const pipeline<It, Stages...> &p, for_each_t<F> s) {
+  p.run(p.first, p.last, [&](auto &&x) { s.f(std::forward<decltype(x)>(x)); return true; });
+}
+
+template<typename It, typename... Stages, typename T, typename Op>
+T operator|(const pipeline<It, Stages...> &p, par_reduce_t<T, Op> s) {
+  static_assert(!pipeline<It, Stages...>::has_take, "take() depends on element order and cannot be used with a parallel sink");
+  static_assert(std::is_base_of<std::random_access_iterator_tag,
+                                typename std::iterator_traits<It>::iterator_category>::value,
+                "par_reduce splits the source by index and needs random access iterators");
+  std::size_t n = std::distance(p.first, p.last);
+  std::size_t chunk = (n + s.threads - 1) / s.threads;
+  std::vector<T> partial(s.threads, s.init);
+  std::vector<std::thread> vt;
+  for(unsigned t = 0; t < s.threads; ++t) {
+    std::size_t lo = std::min(n, t * chunk), hi = std::min(n, lo + chunk);
+    vt.emplace_back([&, t, lo, hi] {
+      T local = s.init;
+      p.run(p.first + lo, p.first + hi, [&](auto &&x) { local = s.op(local, x); return true; });
+      partial[t] = local;
+    });
+  }
+  for(auto &t : vt)
+    t.join();
+  T total = s.init;
+  for(auto &v : partial)
+    total = s.op(total, v);
+  return total;
+}
+
+}  // namespace lazy
+
+using ms = std::chrono::duration<double, std::milli>;
+
+int main() {
+  using namespace lazy;
+
+  /* variable_capture.cc 中的泛型 lambda */
+  auto add = [](auto x, auto y) {
+    return x + y;
+  };
+  auto is_even = [](int x) { return x % 2 == 0; };
+  auto square = [](int x) { return static_cast<long long>(x) * x; };
+
+  std::vector<int> small{1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+  source(small) | filter(is_even) | map(square) | take(3) | for_each([](long long x) { std::cout << x << " "; });
+  std::cout << "\n";
+  auto v = source(small) | map([&](int x) { return add(x, 100); }) | to_vector();
+  std::cout << v.size() << " " << v.front() << " " << v.back() << "\n";
+  /* sum 的结果型别跟随元素型别：double 不会被截断成整数 */
+  std::vector<double> prices{1.25, 2.5, 0.75};
+  auto total = source(prices) | map([](double x) { return x * 2; }) | sum();
+  static_assert(std::is_same<decltype(total), double>::value, "");
+  static_assert(std::is_same<decltype(source(small) | sum()), long long>::value, "");
+  std::cout << "sum of doubled prices: " << total << "\n";
+
+  constexpr std::size_t kSize = 20000000;
+  std::vector<int> data(kSize);
+  std::iota(data.begin(), data.end(), 0);
+  const std::size_t limit = kSize / 4;
+
+  /* 逐步物化：每一步都产生一个中间 vector */
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<int> evens;
+    std::copy_if(data.begin(), data.end(), std::back_inserter(evens), is_even);
+    std::vector<long long> squares(evens.size());
+    std::transform(evens.begin(), evens.end(), squares.begin(), square);
+    squares.resize(std::min(limit, squares.size()));
+    long long total = std::accumulate(squares.begin(), squares.end(), 0LL, add);
+    auto t1 = std::chrono::steady_clock::now();
+    std::size_t bytes = evens.capacity() * sizeof(int) + squares.capacity() * sizeof(long long);
+    std::cout << "materialized: " << ms(t1 - t0).count() << " ms, intermediate buffers "
+              << bytes / (1 << 20) << " MiB, result " << total << "\n";
+  }
+
+  /* 融合的流水线：只有一个循环，没有中间缓冲区，take 满了之后提前结束 */
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    long long total = source(data) | filter(is_even) | map(square) | take(limit) | sum();
+    auto t1 = std::chrono::steady_clock::now();
+    std::cout << "fused:        " << ms(t1 - t0).count() << " ms, intermediate buffers 0 MiB, result " << total << "\n";
+  }
+
+  /* 没有 take 时的对比，以及并行版本 */
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<int> evens;
+    std::copy_if(data.begin(), data.end(), std::back_inserter(evens), is_even);
+    std::vector<long long> squares(evens.size());
+    std::transform(evens.begin(), evens.end(), squares.begin(), square);
+    long long m = std::accumulate(squares.begin(), squares.end(), 0LL);
+    auto t1 = std::chrono::steady_clock::now();
+    long long f = source(data) | filter(is_even) | map(square) | sum();
+    auto t2 = std::chrono::steady_clock::now();
+    long long p = source(data) | filter(is_even) | map(square) | par_sum();
+    auto t3 = std::chrono::steady_clock::now();
+    std::cout << "full range: materialized " << ms(t1 - t0).count() << " ms, fused "
+              << ms(t2 - t1).count() << " ms, parallel fused (" << std::thread::hardware_concurrency()
+              << " threads) " << ms(t3 - t2).count() << " ms, results "
+              << (m == f && f == p ? "equal" : "differ") << "\n";
+  }
+}
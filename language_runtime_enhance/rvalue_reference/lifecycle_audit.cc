@@ -0,0 +1,375 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstdio>
+#include <cxxabi.h>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 拷贝/移动审计工具
+ * move_semantics.cc 中的 class A 在每个构造函数里手写 std::cout 来观察发生的是拷贝还是移动，
+ * 这里把它做成可复用的工具，用于在热点路径上找出隐藏的拷贝：
+ * 1. lifecycle_counter<Tag>：作为基类混入，统计构造、拷贝、移动、赋值、析构的次数
+ *    派生类的特种成员函数使用编译器生成的版本即可，它们会调用基类对应的版本
+ *    它还提供类内的 operator new / delete（因此需要公有继承），用 new 创建派生类对象（包括 make_unique）时按型别统计堆分配的次数和字节数；
+ *    make_shared / allocate_shared 和容器走的是分配器，不经过类内的 operator new，只计入调用点
+ * 2. 替换全局的 operator new / delete（包括对齐的版本），统计堆分配的次数和字节数，并按当前的调用点归类
+ * 3. audit_scope s("name"); ... s.report(); 输出作用域内各型别的计数变化和堆分配
+ *    作用域可以嵌套，内层作用域里的分配同时计入所有外层作用域；调用点的汇总表只计入最内层
+ * 4. EXPECT_NO_COPIES(s, T) / EXPECT_NO_HEAP(s)：测试中的断言，失败时输出位置并累计到 audit_failures
+ */
+
+/* ------------------------------ 型别计数 ------------------------------ */
+struct lifecycle_stats {
+  const char *name;
+  std::atomic<long> constructed{0};
+  std::atomic<long> copies{0};
+  std::atomic<long> moves{0};
+  std::atomic<long> copy_assigns{0};
+  std::atomic<long> move_assigns{0};
+  std::atomic<long> destroyed{0};
+  std::atomic<long> heap_allocs{0};
+  std::atomic<long> heap_bytes{0};
+  lifecycle_stats *next = nullptr;
+};
+
+/* 所有被统计的型别串成一个链表，在静态初始化阶段注册 */
+inline lifecycle_stats *&stats_registry() {
+  static lifecycle_stats *head = nullptr;
+  return head;
+}
+
+inline const char* demangle(const char *name) {
+  int status = 0;
+  char *s = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+  return status == 0 ? s : name;  // 只在注册时调用一次，不释放
+}
+
+template<typename Tag>
+class lifecycle_counter {
+public:
+  lifecycle_counter() noexcept { ++stats.constructed; }
+  lifecycle_counter(const lifecycle_counter&) noexcept { ++stats.copies; }
+  lifecycle_counter(lifecycle_counter&&) noexcept { ++stats.moves; }
+  lifecycle_counter& operator=(const lifecycle_counter&) noexcept { ++stats.copy_assigns; return *this; }
+  lifecycle_counter& operator=(lifecycle_counter&&) noexcept { ++stats.move_assigns; return *this; }
+  ~lifecycle_counter() { ++stats.destroyed; }
+
+  static lifecycle_stats& counters() { return stats; }
+
+  /* 按型别统计的堆分配；n 是派生类对象（或数组）的大小 */
+  static void* operator new(std::size_t n) { return ::operator new(count(n)); }
+  static void* operator new[](std::size_t n) { return ::operator new[](count(n)); }
+  static void* operator new(std::size_t n, std::align_val_t al) { return ::operator new(count(n), al); }
+  static void* operator new[](std::size_t n, std::align_val_t al) { return ::operator new[](count(n), al); }
+  static void operator delete(void *p) noexcept { ::operator delete(p); }
+  static void operator delete[](void *p) noexcept { ::operator delete[](p); }
+  static void operator delete(void *p, std::align_val_t al) noexcept { ::operator delete(p, al); }
+  static void operator delete[](void *p, std::align_val_t al) noexcept { ::operator delete[](p, al); }
+  /* 类内的 operator new 会隐藏全局的 placement new，fast_pimpl、unique_function 之类在自己的缓冲区里构造对象时需要它 */
+  static void* operator new(std::size_t, void *p) noexcept { return p; }
+  static void* operator new[](std::size_t, void *p) noexcept { return p; }
+  static void operator delete(void*, void*) noexcept {}
+  static void operator delete[](void*, void*) noexcept {}
+
+private:
+  static std::size_t count(std::size_t n) noexcept {
+    stats.heap_allocs.fetch_add(1, std::memory_order_relaxed);
+    stats.heap_bytes.fetch_add(static_cast<long>(n), std::memory_order_relaxed);
+    return n;
+  }
+
+  static lifecycle_stats& make_stats() {
+    static lifecycle_stats s;
+    s.name = demangle(typeid(Tag).name());
+    s.next = stats_registry();
+    stats_registry() = &s;
+    return s;
+  }
+
+  static inline lifecycle_stats &stats = make_stats();
+};
+
+/* ------------------------------ 堆分配统计 ------------------------------ */
+constexpr int kMaxSites = 64;
+
+struct heap_site {
+  const char *name = nullptr;
+  std::atomic<long> allocs{0};
+  std::atomic<long> bytes{0};
+};
+
+heap_site g_sites[kMaxSites];      // 0 号为 "<global>"
+std::atomic<int> g_site_count{1};
+
+class audit_scope;
+thread_local audit_scope *t_top_scope = nullptr;  // 当前线程最内层的作用域，外层通过 parent 串起来
+
+void count_heap(std::size_t n);
+
+void* operator new(std::size_t n) {
+  count_heap(n);
+  if(void *p = std::malloc(n == 0 ? 1 : n))
+    return p;
+  throw std::bad_alloc();
+}
+
+/* 过度对齐的型别走这个版本；aligned_alloc 要求大小是对齐的整数倍 */
+void* operator new(std::size_t n, std::align_val_t al) {
+  count_heap(n);
+  std::size_t a = static_cast<std::size_t>(al);
+  if(void *p = std::aligned_alloc(a, (n + a - 1) / a * a + (n == 0 ? a : 0)))
+    return p;
+  throw std::bad_alloc();
+}
+
+/* operator new 也是用 malloc / aligned_alloc 实现的，这里的 free 是匹配的 */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+/* ------------------------------ 作用域 ------------------------------ */
+int audit_failures = 0;
+
+class audit_scope {
+public:
+  explicit audit_scope(const char *name) : parent(t_top_scope) {
+    /* 先拍快照再压栈，快照本身的分配不计入这个作用域，也不计入外层作用域 */
+    t_top_scope = nullptr;
+    for(auto *s = stats_registry(); s; s = s->next)
+      before.push_back(snapshot(*s));
+    site = find_site(name);
+    t_top_scope = this;
+  }
+
+  ~audit_scope() { t_top_scope = parent; }
+
+  audit_scope(const audit_scope&) = delete;
+  audit_scope& operator=(const audit_scope&) = delete;
+
+  /* 作用域开始以来 T 的拷贝次数（拷贝构造 + 拷贝赋值） */
+  template<typename T>
+  long copies() const {
+    const lifecycle_stats &s = T::counters();
+    counts now = snapshot(s);
+    counts old = find(&s);
+    return (now.copies - old.copies) + (now.copy_assigns - old.copy_assigns);
+  }
+
+  /* 包括嵌套在其中的作用域里的分配 */
+  long heap_allocs() const { return allocs; }
+  long heap_bytes() const { return bytes; }
+
+  /* 输出本身的分配不计入任何作用域 */
+  void report(std::ostream &os = std::cout) const {
+    audit_scope *saved = std::exchange(t_top_scope, nullptr);
+    print(os);
+    t_top_scope = saved;
+  }
+
+  /* 各调用点累计的堆分配（只计入分配发生时最内层的作用域） */
+  static void report_sites(std::ostream &os = std::cout) {
+    audit_scope *saved = std::exchange(t_top_scope, nullptr);
+    os << "[heap by call site]\n";
+    int n = std::min(g_site_count.load(), kMaxSites);
+    for(int i = 0; i < n; ++i)
+      if(g_sites[i].allocs != 0)
+        os << "  " << (g_sites[i].name ? g_sites[i].name : "<global>") << ": "
+           << g_sites[i].allocs << " allocations, " << g_sites[i].bytes << " bytes\n";
+    t_top_scope = saved;
+  }
+
+private:
+  friend void count_heap(std::size_t n);
+
+  void print(std::ostream &os) const {
+    os << "[audit " << (g_sites[site].name ? g_sites[site].name : "<global>") << "]\n";
+    for(auto *s = stats_registry(); s; s = s->next) {
+      counts now = snapshot(*s), old = find(s);
+      if(now.constructed + now.copies + now.moves + now.destroyed ==
+         old.constructed + old.copies + old.moves + old.destroyed)
+        continue;
+      os << "  " << s->name << ": construct " << now.constructed - old.constructed
+         << ", copy " << now.copies - old.copies
+         << ", move " << now.moves - old.moves
+         << ", copy= " << now.copy_assigns - old.copy_assigns
+         << ", move= " << now.move_assigns - old.move_assigns
+         << ", destroy " << now.destroyed - old.destroyed;
+      if(now.heap_allocs != old.heap_allocs)
+        os << ", heap " << now.heap_allocs - old.heap_allocs << " allocations "
+           << now.heap_bytes - old.heap_bytes << " bytes";
+      os << "\n";
+    }
+    os << "  heap: " << heap_allocs() << " allocations, " << heap_bytes() << " bytes\n";
+  }
+
+  /* 同一个调用点（同一个名字字符串）多次进入时复用同一个槽位，槽位用完之后合并到 <global> */
+  static int find_site(const char *name) {
+    int n = g_site_count.load();
+    for(int i = 1; i < n && i < kMaxSites; ++i)
+      if(g_sites[i].name == name)
+        return i;
+    int site = g_site_count.fetch_add(1);
+    if(site >= kMaxSites)
+      return 0;
+    g_sites[site].name = name;
+    return site;
+  }
+
+  struct counts {
+    const lifecycle_stats *owner;
+    long constructed, copies, moves, copy_assigns, move_assigns, destroyed, heap_allocs, heap_bytes;
+  };
+
+  static counts snapshot(const lifecycle_stats &s) {
+    return {&s, s.constructed, s.copies, s.moves, s.copy_assigns, s.move_assigns, s.destroyed,
+            s.heap_allocs, s.heap_bytes};
+  }
+
+  counts find(const lifecycle_stats *s) const {
+    for(auto &c : before)
+      if(c.owner == s)
+        return c;
+    return {s, 0, 0, 0, 0, 0, 0, 0, 0};
+  }
+
+  int site;
+  audit_scope *parent;
+  long allocs = 0;  // 只有所属线程会修改
+  long bytes = 0;
+  std::vector<counts> before;
+};
+
+/* 分配计入最内层作用域的调用点，并计入当前线程所有活动的作用域 */
+void count_heap(std::size_t n) {
+  heap_site &s = g_sites[t_top_scope ? t_top_scope->site : 0];
+  s.allocs.fetch_add(1, std::memory_order_relaxed);
+  s.bytes.fetch_add(static_cast<long>(n), std::memory_order_relaxed);
+  for(audit_scope *a = t_top_scope; a; a = a->parent) {
+    ++a->allocs;
+    a->bytes += static_cast<long>(n);
+  }
+}
+
+#define EXPECT_NO_COPIES(scope, T)                                                        \
+  do {                                                                                    \
+    if(long n_ = (scope).copies<T>(); n_ != 0) {                                          \
+      ++audit_failures;                                                                   \
+      std::fprintf(stderr, "%s:%d: EXPECT_NO_COPIES(%s) failed: %ld copies\n",            \
+                   __FILE__, __LINE__, #T, n_);                                           \
+    }                                                                                     \
+  } while(0)
+
+#define EXPECT_NO_HEAP(scope)                                                             \
+  do {                                                                                    \
+    if(long n_ = (scope).heap_allocs(); n_ != 0) {                                        \
+      ++audit_failures;                                                                   \
+      std::fprintf(stderr, "%s:%d: EXPECT_NO_HEAP failed: %ld allocations\n",             \
+                   __FILE__, __LINE__, n_);                                               \
+    }                                                                                     \
+  } while(0)
+
+/* ------------------------------ 使用示例 ------------------------------ */
+
+/* 与 move_semantics.cc 中的 class A 相同，只是不再需要手写输出 */
+class A : public lifecycle_counter<A> {
+public:
+  std::unique_ptr<int> pointer = std::make_unique<int>(1);
+  A() = default;
+  A(const A &a) : lifecycle_counter<A>(a), pointer(std::make_unique<int>(*a.pointer)) {}
+  A(A &&a) = default;
+};
+
+A return_value(bool test) {
+  A a, b;
+  if(test)
+    return a;
+  return b;
+}
+
+/* 带计数的消息型别，长度超过 SSO 的 string 在拷贝时会分配堆内存 */
+struct Message : lifecycle_counter<Message> {
+  std::string body;
+  explicit Message(std::string b) : body(std::move(b)) {}
+};
+
+void use_standard_lib() {
+  Message str(std::string(64, 'x'));
+  std::vector<Message> v;
+  v.reserve(2);
+
+  audit_scope s("use_standard_lib: push_back(str)");
+  v.push_back(str);             // 拷贝，还有一次 string 的堆分配
+  s.report();
+  EXPECT_NO_COPIES(s, Message); // 这里会失败
+}
+
+void use_standard_lib_move() {
+  Message str(std::string(64, 'x'));
+  std::vector<Message> v;
+  v.reserve(2);
+
+  audit_scope s("use_standard_lib: push_back(std::move(str))");
+  v.push_back(std::move(str));  // 移动，没有拷贝也没有堆分配
+  s.report();
+  EXPECT_NO_COPIES(s, Message);
+  EXPECT_NO_HEAP(s);
+}
+
+/* 过度对齐的型别：经过对齐版本的 operator new，同样按型别和调用点统计 */
+struct alignas(64) CacheLine : lifecycle_counter<CacheLine> {
+  char data[64];
+};
+
+/* 在已有的缓冲区中构造（placement new）：不分配内存，只计入构造和析构 */
+void placement_construct() {
+  audit_scope s("placement new");
+  alignas(Message) unsigned char buf[sizeof(Message)];
+  Message *m = new (buf) Message(std::string("short"));
+  m->~Message();
+  alignas(CacheLine) unsigned char line[sizeof(CacheLine)];
+  CacheLine *c = new (line) CacheLine;
+  c->~CacheLine();
+  s.report();
+  EXPECT_NO_HEAP(s);
+}
+
+/* 嵌套的作用域：内层的分配同时出现在外层的计数里，外层的 EXPECT_NO_HEAP 能发现它 */
+void nested_scopes() {
+  audit_scope outer("nested: outer");
+  {
+    audit_scope inner("nested: inner");
+    auto m = std::make_unique<Message>(std::string(64, 'y'));  // Message 对象 + string 的缓冲区
+    auto c = std::make_unique<CacheLine>();
+    inner.report();
+  }
+  outer.report();
+  EXPECT_NO_HEAP(outer);  // 这里会失败
+}
+
+int main() {
+  {
+    audit_scope s("return_value");
+    A obj = return_value(false);
+    s.report();
+    EXPECT_NO_COPIES(s, A);
+  }
+
+  use_standard_lib();
+  use_standard_lib_move();
+  placement_construct();
+  nested_scopes();
+  audit_scope::report_sites();
+
+  std::cout << "audit failures: " << audit_failures << "\n";
+}
@@ -12,7 +12,8 @@ public:
   A(A &a) : pointer(new int(*a.pointer)) {
     std::cout << "拷贝\n";
   }
-  A(A &&a) : pointer(a.pointer) {
+  /* 移动构造函数不会抛出异常，标记 noexcept 后 std::vector 扩容时才会移动而不是拷贝（见 others/noexcept_audit.cc） */
+  A(A &&a) noexcept : pointer(a.pointer) {
     a.pointer = nullptr;
     std::cout << "移动\n";
   }
@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 不可变、引用计数的字节缓冲区
+ * move_semantics.cc 中 use_standard_lib() 的 push_back(str) 会完整拷贝一份字符串，
+ * 把一条消息分发给 N 个消费者时就是 N 次分配加 N 次拷贝
+ *
+ * shared_bytes：
+ * 1. 内容创建之后不可修改，所以拷贝只需要增加引用计数，O(1)
+ * 2. slice(offset, len) 返回共享同一块存储的子视图，也是 O(1)
+ * 3. 不超过 kInline 字节的内容直接放在对象内部，拷贝就是拷贝这几个字节，没有分配也没有原子操作
+ * 4. 可以隐式转换为 std::string_view
+ *
+ * 和 shared_ptr<std::string> 相比，引用计数和数据在同一次分配里，并且少了一次 string 本身的间接寻址
+ */
+class shared_bytes {
+public:
+  static constexpr std::size_t kInline = 23;
+
+  shared_bytes() noexcept : tag(0) {}
+
+  explicit shared_bytes(std::string_view s) {
+    if(s.size() <= kInline) {
+      std::memcpy(small, s.data(), s.size());
+      tag = static_cast<unsigned char>(s.size());
+    } else {
+      block *b = block::create(s);
+      heap = {b, b->data, s.size()};
+      tag = kHeap;
+    }
+  }
+
+  shared_bytes(const shared_bytes &other) noexcept : tag(other.tag) {
+    if(is_heap()) {
+      heap = other.heap;
+      heap.owner->refs.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      std::memcpy(small, other.small, kInline);
+    }
+  }
+
+  shared_bytes(shared_bytes &&other) noexcept { steal(other); }
+
+  /* 按值传参，拷贝赋值和移动赋值共用一个实现 */
+  shared_bytes& operator=(shared_bytes other) noexcept {
+    if(is_heap())
+      heap.owner->release();
+    steal(other);
+    return *this;
+  }
+
+  ~shared_bytes() {
+    if(is_heap())
+      heap.owner->release();
+  }
+
+  const char* data() const noexcept { return is_heap() ? heap.data : small; }
+  std::size_t size() const noexcept { return is_heap() ? heap.size : tag; }
+  bool empty() const noexcept { return size() == 0; }
+  bool is_inline() const noexcept { return !is_heap(); }
+
+  operator std::string_view() const noexcept { return {data(), size()}; }
+  std::string_view view() const noexcept { return {data(), size()}; }
+
+  /* 共享存储的子视图；内联的内容直接拷贝那几个字节 */
+  shared_bytes slice(std::size_t offset, std::size_t len = std::string_view::npos) const {
+    if(offset > size())
+      throw std::out_of_range("shared_bytes::slice");
+    len = std::min(len, size() - offset);
+    if(!is_heap())
+      return shared_bytes(std::string_view(small + offset, len));
+    shared_bytes r;
+    r.heap = {heap.owner, heap.data + offset, len};
+    r.tag = kHeap;
+    heap.owner->refs.fetch_add(1, std::memory_order_relaxed);
+    return r;
+  }
+
+  /* 整块存储的引用计数，内联模式下为 0 */
+  long use_count() const noexcept {
+    return is_heap() ? heap.owner->refs.load(std::memory_order_relaxed) : 0;
+  }
+
+private:
+  static constexpr unsigned char kHeap = 0xff;
+
+  /* 引用计数和数据放在同一次分配中 */
+  struct block {
+    std::atomic<long> refs;
+    char data[1];
+
+    static block* create(std::string_view s) {
+      void *mem = ::operator new(offsetof(block, data) + s.size());
+      block *b = new (mem) block;
+      b->refs.store(1, std::memory_order_relaxed);
+      std::memcpy(b->data, s.data(), s.size());
+      return b;
+    }
+
+    void release() noexcept {
+      if(refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        this->~block();
+        ::operator delete(this);
+      }
+    }
+  };
+
+  struct heap_rep {
+    block *owner;
+    const char *data;
+    std::size_t size;
+  };
+
+  bool is_heap() const noexcept { return tag == kHeap; }
+
+  /* 接管 other 的内容，other 变为空 */
+  void steal(shared_bytes &other) noexcept {
+    tag = other.tag;
+    if(is_heap())
+      heap = other.heap;
+    else
+      std::memcpy(small, other.small, kInline);
+    other.tag = 0;
+  }
+
+  union {
+    heap_rep heap;
+    char small[kInline];
+  };
+  unsigned char tag;  // 内联模式下为长度，kHeap 表示在堆上
+};
+
+static_assert(sizeof(shared_bytes) == 32, "shared_bytes should fit in half a cache line");
+
+void use_standard_lib() {
+  shared_bytes str(std::string_view("Hello World. This payload is longer than the inline buffer."));
+  std::vector<shared_bytes> v;
+
+  /* 拷贝只是增加引用计数，str 仍然可用 */
+  v.push_back(str);
+  v.push_back(str.slice(0, 5));
+  std::cout << "str: " << str.view() << ", use_count = " << str.use_count() << "\n";
+  std::cout << "slice: " << v.back().view() << "\n";
+
+  shared_bytes small(std::string_view("inline"));
+  std::cout << "small is inline: " << std::boolalpha << small.is_inline() << "\n";
+}
+
+using ms = std::chrono::duration<double, std::milli>;
+
+/**
+ * @brief 一条消息分发给 kConsumers 个消费者的队列，每个消费者再读取它
+ */
+template<typename Msg, typename Make, typename Read>
+void fan_out(const char *name, std::size_t payload, Make make, Read read) {
+  constexpr int kMessages = 20000;
+  constexpr int kConsumers = 16;
+  std::string text(payload, 'x');
+  std::vector<std::vector<Msg>> queues(kConsumers);
+  for(auto &q : queues)
+    q.reserve(kMessages);
+
+  auto t0 = std::chrono::steady_clock::now();
+  for(int i = 0; i < kMessages; ++i) {
+    Msg m = make(text);
+    for(auto &q : queues)
+      q.push_back(m);
+  }
+  std::size_t total = 0;
+  for(auto &q : queues)
+    for(auto &m : q)
+      total += read(m);
+  queues.clear();
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << "  " << name << ": " << ms(t1 - t0).count() << " ms (" << total << ")\n";
+}
+
+int main() {
+  use_standard_lib();
+
+  for(std::size_t payload : {16, 256, 4096}) {
+    std::cout << "payload " << payload << " bytes, 16 consumers:\n";
+    fan_out<std::string>("std::string copies      ", payload,
+        [](const std::string &s) { return s; },
+        [](const std::string &m) { return m.size(); });
+    fan_out<std::shared_ptr<const std::string>>("shared_ptr<std::string> ", payload,
+        [](const std::string &s) { return std::make_shared<const std::string>(s); },
+        [](const std::shared_ptr<const std::string> &m) { return m->size(); });
+    fan_out<shared_bytes>("shared_bytes            ", payload,
+        [](const std::string &s) { return shared_bytes(s); },
+        [](const shared_bytes &m) { return m.view().size(); });
+  }
+}
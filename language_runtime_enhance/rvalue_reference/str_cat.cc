@@ -0,0 +1,208 @@
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief 一次分配的字符串拼接
+ * rvalue_reference.cc 中 lv1 + lv1、lv1 + lv2 每个 + 都会产生一个临时的 std::string，
+ * 拼接 n 段就可能分配 n - 1 次，并且前面的内容会被反复拷贝
+ *
+ * 1. str_cat(a, b, c, ...)：先把每个参数转换成 string_view（整数和浮点数用 to_chars 格式化到栈上，不受 locale 影响），
+ *    算出总长度后只分配一次
+ * 2. strx(a) + b + c：表达式模版，+ 只是记录左右两边，转换成 std::string 时才计算长度并一次性拷贝
+ * 3. string_builder：保留内部缓冲区，clear() 之后容量不变，反复组装消息时不再分配
+ */
+
+/* 把一个参数转换为字符串片段，数值类型格式化到内部的缓冲区中 */
+class alpha_num {
+public:
+  alpha_num(std::string_view s) : piece(s) {}
+  alpha_num(const std::string &s) : piece(s) {}
+  alpha_num(const char *s) : piece(s) {}
+  alpha_num(char c) : piece(buf, 1) { buf[0] = c; }
+
+  template<typename T, typename = std::enable_if_t<std::is_arithmetic<T>::value && !std::is_same<T, char>::value>>
+  alpha_num(T v) {
+    if constexpr(std::is_same<T, bool>::value) {
+      piece = v ? "true" : "false";
+    } else {
+      auto r = std::to_chars(buf, buf + sizeof(buf), v);
+      piece = std::string_view(buf, r.ptr - buf);
+    }
+  }
+
+  alpha_num(const alpha_num&) = delete;
+  alpha_num& operator=(const alpha_num&) = delete;
+
+  std::string_view view() const { return piece; }
+
+private:
+  std::string_view piece;
+  char buf[32];  // 足够放下 double 的最短表示
+};
+
+namespace detail {
+
+inline void append_pieces(std::string &out, std::initializer_list<std::string_view> pieces) {
+  std::size_t total = out.size();
+  for(auto p : pieces)
+    total += p.size();
+  out.reserve(total);
+  for(auto p : pieces)
+    out.append(p.data(), p.size());
+}
+
+}  // namespace detail
+
+/* alpha_num 临时对象一直活到整个表达式结束，append_pieces 期间 string_view 都是有效的 */
+template<typename... Ts>
+std::string str_cat(const Ts&... args) {
+  std::string out;
+  detail::append_pieces(out, {alpha_num(args).view()...});
+  return out;
+}
+
+template<typename... Ts>
+void str_append(std::string &out, const Ts&... args) {
+  detail::append_pieces(out, {alpha_num(args).view()...});
+}
+
+/**
+ * @brief 表达式模版
+ * cat_expr 对字符串只保存 string_view，数值在 + 的时候格式化到栈上，链式的 + 构造出一棵在编译期确定形状的树
+ * 转换为 std::string 时先遍历一次求总长度，再遍历一次拷贝
+ * 和 string_view 一样，表达式不能比它引用的字符串活得更久，应该在同一个语句中转换为 std::string
+ */
+template<typename L, typename R>
+struct cat_expr;
+
+struct str_leaf {
+  std::string_view s;
+  std::size_t size() const { return s.size(); }
+  char* write(char *p) const { return static_cast<char*>(std::memcpy(p, s.data(), s.size())) + s.size(); }
+};
+
+template<typename T>
+struct num_leaf {
+  char buf[32];
+  std::size_t len;
+  explicit num_leaf(T v) { len = std::to_chars(buf, buf + sizeof(buf), v).ptr - buf; }
+  std::size_t size() const { return len; }
+  char* write(char *p) const { return static_cast<char*>(std::memcpy(p, buf, len)) + len; }
+};
+
+template<typename L, typename R>
+struct cat_expr {
+  L l;
+  R r;
+  std::size_t size() const { return l.size() + r.size(); }
+  char* write(char *p) const { return r.write(l.write(p)); }
+
+  operator std::string() const {
+    std::string out(size(), '\0');  // 唯一的一次分配
+    write(out.data());
+    return out;
+  }
+};
+
+struct char_leaf {
+  char c;
+  std::size_t size() const { return 1; }
+  char* write(char *p) const { *p = c; return p + 1; }
+};
+
+template<typename T>
+auto make_leaf(const T &v) {
+  if constexpr(std::is_same<T, char>::value)
+    return char_leaf{v};
+  else if constexpr(std::is_same<T, bool>::value)
+    return str_leaf{v ? "true" : "false"};
+  else if constexpr(std::is_arithmetic<T>::value)
+    return num_leaf<T>(v);
+  else
+    return str_leaf{std::string_view(v)};
+}
+
+template<typename L, typename R, typename T>
+auto operator+(cat_expr<L, R> e, const T &v) {
+  return cat_expr<cat_expr<L, R>, decltype(make_leaf(v))>{e, make_leaf(v)};
+}
+
+/* 表达式的起点：strx(a) + b + ... */
+struct empty_leaf {
+  std::size_t size() const { return 0; }
+  char* write(char *p) const { return p; }
+};
+
+template<typename T>
+auto strx(const T &v) {
+  return cat_expr<empty_leaf, decltype(make_leaf(v))>{{}, make_leaf(v)};
+}
+
+/* 可以复用的构建器，clear() 只清空内容，不释放缓冲区 */
+class string_builder {
+public:
+  explicit string_builder(std::size_t reserve = 256) { buf.reserve(reserve); }
+
+  template<typename... Ts>
+  string_builder& append(const Ts&... args) {
+    str_append(buf, args...);
+    return *this;
+  }
+
+  void clear() { buf.clear(); }
+  std::string_view view() const { return buf; }
+  const std::string& str() const { return buf; }
+
+private:
+  std::string buf;
+};
+
+using ns = std::chrono::duration<double, std::nano>;
+
+template<typename F>
+void bench(const char *name, F f) {
+  constexpr int kIters = 1000000;
+  std::size_t total = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for(int i = 0; i < kIters; ++i)
+    total += f(i);
+  auto t1 = std::chrono::steady_clock::now();
+  std::cout << name << ": " << ns(t1 - t0).count() / kIters << " ns/message (" << total << ")\n";
+}
+
+int main() {
+  std::string lv1 = "string";
+  const std::string &lv2 = lv1 + lv1;
+  std::cout << str_cat(lv1, lv2) << "\n";
+  std::string s = strx(lv1) + lv2 + ' ' + '#' + 42 + " " + 3.25 + ' ' + false;
+  std::cout << s << "\n";
+  std::cout << str_cat("pi=", 3.14159, " n=", -17, " ok=", true, ' ', 1u << 31) << "\n";
+
+  /* 典型的日志消息：10 段左右的拼接 */
+  const std::string user = "alice", action = "login", host = "server-01.example.com";
+  bench("chained std::string +", [&](int i) {
+    std::string m = "[" + host + "] user=" + user + " action=" + action + " id=" + std::to_string(i) +
+                    " latency=" + std::to_string(i * 0.5) + "ms";
+    return m.size();
+  });
+  bench("str_cat              ", [&](int i) {
+    std::string m = str_cat("[", host, "] user=", user, " action=", action, " id=", i, " latency=", i * 0.5, "ms");
+    return m.size();
+  });
+  bench("expression template  ", [&](int i) {
+    std::string m = strx("[") + host + "] user=" + user + " action=" + action + " id=" + i +
+                    " latency=" + i * 0.5 + "ms";
+    return m.size();
+  });
+  string_builder sb;
+  bench("string_builder       ", [&](int i) {
+    sb.clear();
+    sb.append("[", host, "] user=", user, " action=", action, " id=", i, " latency=", i * 0.5, "ms");
+    return sb.view().size();
+  });
+}
@@ -0,0 +1,291 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 缓存行对齐与伪共享
+ * memory_align.cc 只关心单个结构体内部的对齐；多线程时更重要的是缓存行：
+ * 两个线程各自写自己的变量，只要这两个变量落在同一个缓存行里，这一行就会在两个核的缓存之间来回传递（伪共享），
+ * 互不相关的写操作被串行化，吞吐量可以下降一个数量级
+ *
+ * 1. kCacheLine：优先使用 std::hardware_destructive_interference_size，标准库不提供时退回到 64
+ * 2. cache_padded<T>：对齐到缓存行并填充到缓存行的整数倍，保证不和任何其它对象共享缓存行
+ * 3. per_thread<T>：每个线程一个槽位的数组，每个槽位都是 cache_padded 的
+ * 4. false_sharing_detector：调试用的工具，对写操作采样，记录每个缓存行上一次写入的线程和字节，
+ *    不同线程交替写同一行中互不重叠的字节时记为一次伪共享，最后报告最热的几行
+ *    FS_TRACK_WRITE(p) 只在没有定义 NDEBUG（或者定义了 FALSE_SHARING_DETECT）时生效，发布版本中什么也不做
+ */
+
+/* x86 上相邻缓存行预取会让 128 字节的间隔效果更好，这里仍然使用标准库给出的值 */
+#ifdef __cpp_lib_hardware_interference_size
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Winterference-size"
+constexpr std::size_t kCacheLine = std::hardware_destructive_interference_size;
+#pragma GCC diagnostic pop
+#else
+constexpr std::size_t kCacheLine = 64;
+#endif
+
+template<typename T>
+struct alignas(kCacheLine) cache_padded {
+  T value;
+
+  cache_padded() = default;
+  template<typename... Args>
+  explicit cache_padded(std::in_place_t, Args&&... args) : value(std::forward<Args>(args)...) {}
+
+  T& operator*() noexcept { return value; }
+  const T& operator*() const noexcept { return value; }
+  T* operator->() noexcept { return &value; }
+  const T* operator->() const noexcept { return &value; }
+};
+
+static_assert(sizeof(cache_padded<char>) == kCacheLine, "");
+static_assert(alignof(cache_padded<char>) == kCacheLine, "");
+
+/* 每个线程一个槽位，C++17 的 operator new 会按照 cache_padded 的对齐分配 */
+template<typename T>
+class per_thread {
+public:
+  explicit per_thread(std::size_t threads) : slots(threads) {}
+
+  T& operator[](std::size_t i) noexcept { return *slots[i]; }
+  const T& operator[](std::size_t i) const noexcept { return *slots[i]; }
+  std::size_t size() const noexcept { return slots.size(); }
+
+  template<typename R, typename F>
+  R combine(R init, F f) const {
+    for(auto &s : slots)
+      init = f(init, *s);
+    return init;
+  }
+
+private:
+  std::vector<cache_padded<T>> slots;
+};
+
+/* ------------------------------ 伪共享检测 ------------------------------ */
+class false_sharing_detector {
+public:
+  static false_sharing_detector& instance() {
+    static false_sharing_detector d;
+    return d;
+  }
+
+  /* 给一块内存起个名字，报告中按 名字+偏移 显示 */
+  void label(const void *p, std::size_t size, const char *name) {
+    if(n_labels < kMaxLabels)
+      labels[n_labels++] = {reinterpret_cast<std::uintptr_t>(p), size, name};
+  }
+
+  /* 每个线程每 kSampleEvery 次写入记录一次 */
+  void on_write(const void *p, std::size_t size) {
+    thread_local unsigned counter = 0;
+    if(++counter % kSampleEvery != 0)
+      return;
+    auto addr = reinterpret_cast<std::uintptr_t>(p);
+    std::uintptr_t line = addr / kCacheLine * kCacheLine;
+    std::uint64_t bytes = byte_mask(addr - line, size);
+    std::uint32_t tid = thread_index();
+
+    slot &s = find(line);
+    s.samples.fetch_add(1, std::memory_order_relaxed);
+    std::uint32_t last = s.last_tid.exchange(tid, std::memory_order_relaxed);
+    std::uint64_t last_bytes = s.last_bytes.exchange(bytes, std::memory_order_relaxed);
+    if(last != kNoThread && last != tid) {
+      s.handoffs.fetch_add(1, std::memory_order_relaxed);
+      if((last_bytes & bytes) == 0)  // 写的是不同的字节：伪共享
+        s.false_handoffs.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void report(std::size_t top = 5) const {
+    std::vector<const slot*> hot;
+    for(auto &s : table)
+      if(s.line.load() != 0 && s.false_handoffs.load() > 0)
+        hot.push_back(&s);
+    std::sort(hot.begin(), hot.end(), [](const slot *a, const slot *b) {
+      return a->false_handoffs.load() > b->false_handoffs.load();
+    });
+    if(hot.empty()) {
+      std::cout << "  no falsely shared cache lines detected\n";
+      return;
+    }
+    for(std::size_t i = 0; i < hot.size() && i < top; ++i) {
+      const slot &s = *hot[i];
+      std::uintptr_t line = s.line.load();
+      std::cout << "  line 0x" << std::hex << line << std::dec << " (" << describe(line) << "): "
+                << s.samples.load() << " sampled writes, " << s.handoffs.load() << " writer changes, "
+                << s.false_handoffs.load() << " to disjoint bytes\n";
+    }
+  }
+
+  void reset() {
+    for(auto &s : table) {
+      s.line = 0;
+      s.last_tid = kNoThread;
+      s.last_bytes = 0;
+      s.samples = s.handoffs = s.false_handoffs = 0;
+    }
+    n_labels = 0;
+  }
+
+private:
+  static constexpr unsigned kSampleEvery = 16;
+  static constexpr std::size_t kSlots = 4096;
+  static constexpr std::size_t kMaxLabels = 32;
+  static constexpr std::uint32_t kNoThread = ~0u;
+
+  struct slot {
+    std::atomic<std::uintptr_t> line{0};
+    std::atomic<std::uint32_t> last_tid{kNoThread};
+    std::atomic<std::uint64_t> last_bytes{0};
+    std::atomic<std::uint64_t> samples{0};
+    std::atomic<std::uint64_t> handoffs{0};
+    std::atomic<std::uint64_t> false_handoffs{0};
+  };
+
+  struct region {
+    std::uintptr_t begin;
+    std::size_t size;
+    const char *name;
+  };
+
+  /**
+   * 写入覆盖的字节在行内的位图，每一位代表 kGranule 个字节
+   * kCacheLine 不超过 64 时一位就是一个字节；aarch64 上 GCC 给出 256，这时按 4 字节一位记录
+   */
+  static constexpr std::size_t kGranule = (kCacheLine + 63) / 64;
+  static_assert(kCacheLine / kGranule <= 64, "byte mask must fit in 64 bits");
+
+  static std::uint64_t byte_mask(std::size_t offset, std::size_t size) {
+    size = std::min(size, kCacheLine - offset);
+    if(size == 0)
+      return 0;
+    std::size_t first = offset / kGranule, last = (offset + size - 1) / kGranule;
+    std::uint64_t upto = last >= 63 ? ~0ull : (1ull << (last + 1)) - 1;
+    return upto & (~0ull << first);
+  }
+
+  static std::uint32_t thread_index() {
+    static std::atomic<std::uint32_t> next{0};
+    thread_local std::uint32_t id = next++;
+    return id;
+  }
+
+  /* 开放寻址，表满时所有的行共用最后探测到的槽位（只是统计会变得不准确） */
+  slot& find(std::uintptr_t line) {
+    std::size_t i = (line / kCacheLine * 0x9E3779B97F4A7C15ull) >> 52;
+    for(std::size_t probe = 0; probe < kSlots; ++probe, i = (i + 1) % kSlots) {
+      std::uintptr_t cur = table[i].line.load(std::memory_order_relaxed);
+      if(cur == line)
+        return table[i];
+      if(cur == 0 && table[i].line.compare_exchange_strong(cur, line))
+        return table[i];
+      if(cur == line)  // 另一个线程刚刚占用了这个槽位记录同一行，CAS 失败时 cur 被更新
+        return table[i];
+    }
+    return table[i];
+  }
+
+  std::string describe(std::uintptr_t line) const {
+    std::string out;
+    for(std::size_t i = 0; i < n_labels; ++i) {
+      const region &r = labels[i];
+      if(line + kCacheLine > r.begin && line < r.begin + r.size) {
+        if(!out.empty())
+          out += ", ";
+        out += r.name;
+        out += line >= r.begin ? "+" + std::to_string(line - r.begin) : "-" + std::to_string(r.begin - line);
+      }
+    }
+    return out.empty() ? "unlabelled" : out;
+  }
+
+  slot table[kSlots];
+  region labels[kMaxLabels];
+  std::size_t n_labels = 0;
+};
+
+#if !defined(NDEBUG) || defined(FALSE_SHARING_DETECT)
+#define FS_TRACK_WRITE(p) false_sharing_detector::instance().on_write((p), sizeof(*(p)))
+#else
+#define FS_TRACK_WRITE(p) ((void)0)
+#endif
+
+/* ------------------------------ 测试 ------------------------------ */
+using ms = std::chrono::duration<double, std::milli>;
+
+constexpr long kIncrements = 20000000;
+
+/* 每个线程只递增属于自己的计数器 */
+template<typename Counter>
+double run(unsigned threads, Counter counter) {
+  std::vector<std::thread> vt;
+  auto t0 = std::chrono::steady_clock::now();
+  for(unsigned t = 0; t < threads; ++t)
+    vt.emplace_back([&, t] {
+      std::atomic<long> &c = counter(t);
+      for(long i = 0; i < kIncrements; ++i)
+        c.fetch_add(1, std::memory_order_relaxed);
+    });
+  for(auto &t : vt)
+    t.join();
+  return ms(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main() {
+  std::cout << "cache line: " << kCacheLine << " bytes, sizeof(cache_padded<std::atomic<long>>) = "
+            << sizeof(cache_padded<std::atomic<long>>) << "\n";
+
+  unsigned hw = std::max(2u, std::thread::hardware_concurrency());
+  std::cout << "hardware threads: " << std::thread::hardware_concurrency()
+            << " (false sharing needs at least two cores running at the same time)\n";
+
+  for(unsigned threads = 1; threads <= std::min(hw, 8u); threads *= 2) {
+    /* 相邻的计数器挤在同一个缓存行里 */
+    std::vector<std::atomic<long>> packed(threads);
+    double t_packed = run(threads, [&](unsigned t) -> std::atomic<long>& { return packed[t]; });
+
+    per_thread<std::atomic<long>> padded(threads);
+    double t_padded = run(threads, [&](unsigned t) -> std::atomic<long>& { return padded[t]; });
+
+    double total = static_cast<double>(kIncrements) * threads;
+    std::cout << threads << " threads: packed " << total / t_packed / 1e3 << " M inc/s, padded "
+              << total / t_padded / 1e3 << " M inc/s\n";
+  }
+
+  /* 检测器：同样的两种布局，每次写之前调用 FS_TRACK_WRITE */
+  auto &detector = false_sharing_detector::instance();
+  auto instrumented = [&](const char *name, auto &counters, unsigned threads) {
+    detector.reset();
+    detector.label(&counters[0], sizeof(counters[0]) * threads, name);
+    std::vector<std::thread> vt;
+    for(unsigned t = 0; t < threads; ++t)
+      vt.emplace_back([&, t] {
+        for(long i = 0; i < kIncrements / 10; ++i) {
+          FS_TRACK_WRITE(&counters[t]);
+          counters[t].fetch_add(1, std::memory_order_relaxed);
+        }
+      });
+    for(auto &t : vt)
+      t.join();
+    std::cout << "detector on " << name << ":\n";
+    detector.report();
+  };
+  {
+    std::vector<std::atomic<long>> packed(4);
+    instrumented("packed", packed, 4);
+    per_thread<std::atomic<long>> padded(4);
+    instrumented("padded", padded, 4);
+  }
+}
@@ -0,0 +1,545 @@
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief expected<T, E>：用返回值传递错误
+ * noexcept.cc 中的 may_throw() 用 throw 报告错误。解析器里错误的输入很常见，
+ * 而抛出一次异常要花费微秒级的时间（分配异常对象、两阶段栈展开、查找 .eh_frame），
+ * 多线程时 libgcc 的展开器还要争用全局的锁，失败率一高吞吐量就掉下来
+ *
+ * 这里实现 C++23 std::expected 的接口（标准库提供 <expected> 之前可以直接替换）：
+ * 1. unexpected<E>、unexpect、bad_expected_access<E>
+ * 2. has_value / operator bool / value / error / value_or / operator* / operator-> / emplace / ==
+ * 3. 单子操作 and_then / transform / or_else / transform_error，expected<void, E> 的特化
+ * 4. T 和 E 都可以平凡拷贝时 expected<T, E> 也是平凡可拷贝的，可以放进寄存器返回、用 memcpy 搬运
+ * 5. TRY(expr)：出错时把错误原样返回给调用者，否则得到值；使用了 GCC/Clang 的语句表达式扩展
+ */
+
+namespace expect {
+
+template<typename E>
+class unexpected {
+public:
+  template<typename G = E, typename = std::enable_if_t<!std::is_same_v<std::decay_t<G>, unexpected>>>
+  constexpr explicit unexpected(G &&e) : err(std::forward<G>(e)) {}
+
+  constexpr E& error() & noexcept { return err; }
+  constexpr const E& error() const & noexcept { return err; }
+  constexpr E&& error() && noexcept { return std::move(err); }
+
+  friend constexpr bool operator==(const unexpected &a, const unexpected &b) { return a.err == b.err; }
+
+private:
+  E err;
+};
+
+template<typename E>
+unexpected(E) -> unexpected<E>;
+
+struct unexpect_t {
+  explicit unexpect_t() = default;
+};
+inline constexpr unexpect_t unexpect{};
+
+template<typename E>
+class bad_expected_access : public std::exception {
+public:
+  explicit bad_expected_access(E e) : err(std::move(e)) {}
+  const char* what() const noexcept override { return "bad expected access"; }
+  const E& error() const & noexcept { return err; }
+
+private:
+  E err;
+};
+
+namespace detail {
+
+/* T 和 E 都平凡可拷贝时使用编译器生成的特种成员函数，expected 本身也就平凡可拷贝 */
+template<typename T, typename E, bool Trivial = std::is_trivially_copyable_v<T> && std::is_trivially_copyable_v<E>>
+struct storage {
+  template<typename... Args>
+  constexpr storage(std::in_place_t, Args&&... args) : val(std::forward<Args>(args)...), has(true) {}
+  template<typename... Args>
+  constexpr storage(unexpect_t, Args&&... args) : err(std::forward<Args>(args)...), has(false) {}
+
+  void destroy() noexcept {}
+
+  union {
+    T val;
+    E err;
+  };
+  bool has;
+};
+
+template<typename T, typename E>
+struct storage<T, E, false> {
+  template<typename... Args>
+  storage(std::in_place_t, Args&&... args) : val(std::forward<Args>(args)...), has(true) {}
+  template<typename... Args>
+  storage(unexpect_t, Args&&... args) : err(std::forward<Args>(args)...), has(false) {}
+
+  storage(const storage &o) : has(o.has) {
+    if(has)
+      new (&val) T(o.val);
+    else
+      new (&err) E(o.err);
+  }
+  storage(storage &&o) noexcept(std::is_nothrow_move_constructible_v<T> && std::is_nothrow_move_constructible_v<E>)
+      : has(o.has) {
+    if(has)
+      new (&val) T(std::move(o.val));
+    else
+      new (&err) E(std::move(o.err));
+  }
+  /* 参数按值传入，拷贝发生在修改 *this 之前；状态切换时要求移动构造不抛出异常 */
+  storage& operator=(storage o) {
+    if(has && o.has) {
+      val = std::move(o.val);
+    } else if(!has && !o.has) {
+      err = std::move(o.err);
+    } else {
+      destroy();
+      if(o.has)
+        new (&val) T(std::move(o.val));
+      else
+        new (&err) E(std::move(o.err));
+      has = o.has;
+    }
+    return *this;
+  }
+  ~storage() { destroy(); }
+
+  void destroy() noexcept {
+    if(has)
+      val.~T();
+    else
+      err.~E();
+  }
+
+  union {
+    T val;
+    E err;
+  };
+  bool has;
+};
+
+template<typename T>
+struct is_expected : std::false_type {};
+
+}  // namespace detail
+
+template<typename T, typename E>
+class expected;
+
+namespace detail {
+template<typename T, typename E>
+struct is_expected<expected<T, E>> : std::true_type {};
+}  // namespace detail
+
+template<typename T, typename E>
+class expected {
+  static_assert(!std::is_reference_v<T> && !std::is_reference_v<E>, "expected does not hold references");
+
+public:
+  using value_type = T;
+  using error_type = E;
+  using unexpected_type = unexpected<E>;
+  template<typename U>
+  using rebind = expected<U, error_type>;
+
+  template<typename U = T, typename = std::enable_if_t<std::is_default_constructible_v<U>>>
+  constexpr expected() : s(std::in_place) {}
+
+  template<typename U = T,
+           typename = std::enable_if_t<!std::is_same_v<std::decay_t<U>, expected> &&
+                                       !std::is_same_v<std::decay_t<U>, std::in_place_t> &&
+                                       !std::is_same_v<std::decay_t<U>, unexpect_t> &&
+                                       std::is_constructible_v<T, U>>>
+  constexpr expected(U &&v) : s(std::in_place, std::forward<U>(v)) {}
+
+  template<typename G>
+  constexpr expected(const unexpected<G> &u) : s(unexpect, u.error()) {}
+  template<typename G>
+  constexpr expected(unexpected<G> &&u) : s(unexpect, std::move(u).error()) {}
+
+  template<typename... Args>
+  constexpr explicit expected(std::in_place_t, Args&&... args) : s(std::in_place, std::forward<Args>(args)...) {}
+  template<typename... Args>
+  constexpr explicit expected(unexpect_t, Args&&... args) : s(unexpect, std::forward<Args>(args)...) {}
+
+  constexpr bool has_value() const noexcept { return s.has; }
+  constexpr explicit operator bool() const noexcept { return s.has; }
+
+  constexpr T& operator*() & noexcept { return s.val; }
+  constexpr const T& operator*() const & noexcept { return s.val; }
+  constexpr T&& operator*() && noexcept { return std::move(s.val); }
+  constexpr T* operator->() noexcept { return &s.val; }
+  constexpr const T* operator->() const noexcept { return &s.val; }
+
+  constexpr T& value() & { check(); return s.val; }
+  constexpr const T& value() const & { check(); return s.val; }
+  constexpr T&& value() && { check(); return std::move(s.val); }
+
+  constexpr E& error() & noexcept { return s.err; }
+  constexpr const E& error() const & noexcept { return s.err; }
+  constexpr E&& error() && noexcept { return std::move(s.err); }
+
+  template<typename U>
+  constexpr T value_or(U &&v) const & { return s.has ? s.val : static_cast<T>(std::forward<U>(v)); }
+  template<typename U>
+  constexpr T value_or(U &&v) && { return s.has ? std::move(s.val) : static_cast<T>(std::forward<U>(v)); }
+
+  /* 与 C++23 一样要求构造不抛出异常，否则旧的值已经销毁而新的值没有构造出来 */
+  template<typename... Args>
+  T& emplace(Args&&... args) noexcept {
+    static_assert(std::is_nothrow_constructible_v<T, Args...>, "emplace requires a nothrow constructor");
+    s.destroy();
+    new (&s.val) T(std::forward<Args>(args)...);
+    s.has = true;
+    return s.val;
+  }
+
+  /* f(value) 返回 expected<U, E> */
+  template<typename F> constexpr auto and_then(F &&f) & { return and_then_impl(*this, std::forward<F>(f)); }
+  template<typename F> constexpr auto and_then(F &&f) const & { return and_then_impl(*this, std::forward<F>(f)); }
+  template<typename F> constexpr auto and_then(F &&f) && { return and_then_impl(std::move(*this), std::forward<F>(f)); }
+
+  /* f(value) 返回 U，结果是 expected<U, E> */
+  template<typename F> constexpr auto transform(F &&f) & { return transform_impl(*this, std::forward<F>(f)); }
+  template<typename F> constexpr auto transform(F &&f) const & { return transform_impl(*this, std::forward<F>(f)); }
+  template<typename F> constexpr auto transform(F &&f) && { return transform_impl(std::move(*this), std::forward<F>(f)); }
+
+  /* f(error) 返回 expected<T, G> */
+  template<typename F> constexpr auto or_else(F &&f) & { return or_else_impl(*this, std::forward<F>(f)); }
+  template<typename F> constexpr auto or_else(F &&f) const & { return or_else_impl(*this, std::forward<F>(f)); }
+  template<typename F> constexpr auto or_else(F &&f) && { return or_else_impl(std::move(*this), std::forward<F>(f)); }
+
+  /* f(error) 返回 G，结果是 expected<T, G> */
+  template<typename F> constexpr auto transform_error(F &&f) & { return transform_error_impl(*this, std::forward<F>(f)); }
+  template<typename F> constexpr auto transform_error(F &&f) const & { return transform_error_impl(*this, std::forward<F>(f)); }
+  template<typename F> constexpr auto transform_error(F &&f) && { return transform_error_impl(std::move(*this), std::forward<F>(f)); }
+
+  friend constexpr bool operator==(const expected &a, const expected &b) {
+    if(a.has_value() != b.has_value())
+      return false;
+    return a.has_value() ? *a == *b : a.error() == b.error();
+  }
+  template<typename G>
+  friend constexpr bool operator==(const expected &a, const unexpected<G> &u) {
+    return !a.has_value() && a.error() == u.error();
+  }
+
+private:
+  constexpr void check() const {
+    if(!s.has)
+      throw bad_expected_access<E>(s.err);
+  }
+
+  template<typename Self, typename F>
+  static constexpr auto and_then_impl(Self &&self, F &&f) {
+    using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, decltype(*std::forward<Self>(self))>>>;
+    static_assert(detail::is_expected<R>::value, "and_then: f must return an expected");
+    static_assert(std::is_same_v<typename R::error_type, E>, "and_then: f must keep the error type");
+    if(self.has_value())
+      return std::invoke(std::forward<F>(f), *std::forward<Self>(self));
+    return R(unexpect, std::forward<Self>(self).error());
+  }
+
+  template<typename Self, typename F>
+  static constexpr auto transform_impl(Self &&self, F &&f) {
+    using U = std::remove_cv_t<std::invoke_result_t<F, decltype(*std::forward<Self>(self))>>;
+    using R = expected<U, E>;
+    if(!self.has_value())
+      return R(unexpect, std::forward<Self>(self).error());
+    if constexpr(std::is_void_v<U>) {
+      std::invoke(std::forward<F>(f), *std::forward<Self>(self));
+      return R();
+    } else {
+      return R(std::in_place, std::invoke(std::forward<F>(f), *std::forward<Self>(self)));
+    }
+  }
+
+  template<typename Self, typename F>
+  static constexpr auto or_else_impl(Self &&self, F &&f) {
+    using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, decltype(std::forward<Self>(self).error())>>>;
+    static_assert(detail::is_expected<R>::value, "or_else: f must return an expected");
+    static_assert(std::is_same_v<typename R::value_type, T>, "or_else: f must keep the value type");
+    if(self.has_value())
+      return R(std::in_place, *std::forward<Self>(self));
+    return std::invoke(std::forward<F>(f), std::forward<Self>(self).error());
+  }
+
+  template<typename Self, typename F>
+  static constexpr auto transform_error_impl(Self &&self, F &&f) {
+    using G = std::remove_cv_t<std::invoke_result_t<F, decltype(std::forward<Self>(self).error())>>;
+    using R = expected<T, G>;
+    if(self.has_value())
+      return R(std::in_place, *std::forward<Self>(self));
+    return R(unexpect, std::invoke(std::forward<F>(f), std::forward<Self>(self).error()));
+  }
+
+  detail::storage<T, E> s;
+};
+
+/* expected<void, E>：只关心成功与否，借用一个空的值类型实现 */
+namespace detail {
+struct unit {
+  friend constexpr bool operator==(unit, unit) { return true; }
+};
+}  // namespace detail
+
+template<typename E>
+class expected<void, E> {
+public:
+  using value_type = void;
+  using error_type = E;
+  using unexpected_type = unexpected<E>;
+  template<typename U>
+  using rebind = expected<U, error_type>;
+
+  constexpr expected() noexcept : s(std::in_place) {}
+  template<typename G>
+  constexpr expected(const unexpected<G> &u) : s(unexpect, u.error()) {}
+  template<typename G>
+  constexpr expected(unexpected<G> &&u) : s(unexpect, std::move(u).error()) {}
+  constexpr explicit expected(std::in_place_t) noexcept : s(std::in_place) {}
+  template<typename... Args>
+  constexpr explicit expected(unexpect_t, Args&&... args) : s(unexpect, std::forward<Args>(args)...) {}
+
+  constexpr bool has_value() const noexcept { return s.has; }
+  constexpr explicit operator bool() const noexcept { return s.has; }
+  constexpr void operator*() const noexcept {}
+  constexpr void value() const & {
+    if(!s.has)
+      throw bad_expected_access<E>(s.err);
+  }
+  constexpr void value() && {
+    if(!s.has)
+      throw bad_expected_access<E>(std::move(s.err));
+  }
+  constexpr E& error() & noexcept { return s.err; }
+  constexpr const E& error() const & noexcept { return s.err; }
+  constexpr E&& error() && noexcept { return std::move(s.err); }
+
+  template<typename F>
+  constexpr auto and_then(F &&f) const & {
+    using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F>>>;
+    static_assert(detail::is_expected<R>::value, "and_then: f must return an expected");
+    return s.has ? std::invoke(std::forward<F>(f)) : R(unexpect, s.err);
+  }
+  template<typename F>
+  constexpr auto transform(F &&f) const & {
+    using U = std::remove_cv_t<std::invoke_result_t<F>>;
+    if(!s.has)
+      return expected<U, E>(unexpect, s.err);
+    if constexpr(std::is_void_v<U>) {
+      std::invoke(std::forward<F>(f));
+      return expected<U, E>();
+    } else {
+      return expected<U, E>(std::in_place, std::invoke(std::forward<F>(f)));
+    }
+  }
+  template<typename F>
+  constexpr auto or_else(F &&f) const & {
+    using R = std::remove_cv_t<std::remove_reference_t<std::invoke_result_t<F, const E&>>>;
+    static_assert(std::is_void_v<typename R::value_type>, "or_else: f must keep the value type");
+    return s.has ? R() : std::invoke(std::forward<F>(f), s.err);
+  }
+  template<typename F>
+  constexpr auto transform_error(F &&f) const & {
+    using G = std::remove_cv_t<std::invoke_result_t<F, const E&>>;
+    return s.has ? expected<void, G>() : expected<void, G>(unexpect, std::invoke(std::forward<F>(f), s.err));
+  }
+
+  friend constexpr bool operator==(const expected &a, const expected &b) {
+    return a.has_value() == b.has_value() && (a.has_value() || a.error() == b.error());
+  }
+
+private:
+  detail::storage<detail::unit, E> s;
+};
+
+namespace detail {
+template<typename E>
+struct is_expected<expected<void, E>> : std::true_type {};
+}  // namespace detail
+
+}  // namespace expect
+
+/* 出错时立即返回错误（由返回类型的 expected 从 unexpected 构造），否则整个表达式的值是 expr 的值 */
+#define TRY(...)                                                      \
+  ({                                                                  \
+    auto &&try_result_ = (__VA_ARGS__);                               \
+    if(!try_result_.has_value())                                      \
+      return ::expect::unexpected(std::move(try_result_).error());    \
+    *std::move(try_result_);                                          \
+  })
+
+/* ------------------------------ 测试 ------------------------------ */
+using expect::expected;
+using expect::unexpected;
+
+enum class parse_error : std::uint8_t { empty, bad_digit, overflow, missing_separator };
+
+const char* to_string(parse_error e) {
+  switch(e) {
+    case parse_error::empty: return "empty";
+    case parse_error::bad_digit: return "bad digit";
+    case parse_error::overflow: return "overflow";
+    case parse_error::missing_separator: return "missing separator";
+  }
+  return "?";
+}
+
+static_assert(std::is_trivially_copyable_v<expected<int, parse_error>>, "");
+static_assert(std::is_trivially_copyable_v<expected<void, parse_error>>, "");
+static_assert(!std::is_trivially_copyable_v<expected<std::string, parse_error>>, "");
+static_assert(sizeof(expected<int, parse_error>) == 8, "fits in one register");
+
+struct record {
+  int key;
+  int value;
+};
+
+/* ---- 返回值版本 ---- */
+expected<int, parse_error> parse_int(std::string_view s) {
+  if(s.empty())
+    return unexpected(parse_error::empty);
+  int v = 0;
+  auto [p, ec] = std::from_chars(s.data(), s.data() + s.size(), v);
+  if(ec == std::errc::result_out_of_range)
+    return unexpected(parse_error::overflow);
+  if(ec != std::errc() || p != s.data() + s.size())
+    return unexpected(parse_error::bad_digit);
+  return v;
+}
+
+/* 两层 TRY，失败从最里层传到调用者 */
+expected<record, parse_error> parse_record(std::string_view line) {
+  std::size_t eq = line.find('=');
+  if(eq == std::string_view::npos)
+    return unexpected(parse_error::missing_separator);
+  int key = TRY(parse_int(line.substr(0, eq)));
+  int value = TRY(parse_int(line.substr(eq + 1)));
+  return record{key, value};
+}
+
+/* ---- 异常版本 ---- */
+struct parse_failure : std::runtime_error {
+  parse_error code;
+  explicit parse_failure(parse_error e) : std::runtime_error(to_string(e)), code(e) {}
+};
+
+/* noinline 让异常真正地穿过函数栈帧 */
+__attribute__((noinline)) int parse_int_throw(std::string_view s) {
+  expected<int, parse_error> r = parse_int(s);
+  if(!r)
+    throw parse_failure(r.error());
+  return *r;
+}
+
+__attribute__((noinline)) record parse_record_throw(std::string_view line) {
+  std::size_t eq = line.find('=');
+  if(eq == std::string_view::npos)
+    throw parse_failure(parse_error::missing_separator);
+  return {parse_int_throw(line.substr(0, eq)), parse_int_throw(line.substr(eq + 1))};
+}
+
+/* 按失败率生成输入，失败的行在值里混入一个字母 */
+std::vector<std::string> make_input(std::size_t n, double failure_rate) {
+  std::vector<std::string> lines;
+  lines.reserve(n);
+  std::uint64_t x = 88172645463325252ull;
+  for(std::size_t i = 0; i < n; ++i) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    std::string line = std::to_string(i % 10007) + "=" + std::to_string(x % 1000000);
+    if(static_cast<double>(x % 1000000) / 1000000 < failure_rate)
+      line.back() = 'x';
+    lines.push_back(std::move(line));
+  }
+  return lines;
+}
+
+using ns = std::chrono::duration<double, std::nano>;
+
+/* threads 个线程各自解析一遍全部输入，返回墙上时间除以所有线程解析的总行数；没有争用时不随线程数变化 */
+template<typename Parse>
+double run(const std::vector<std::string> &lines, unsigned threads, Parse parse) {
+  std::vector<std::thread> vt;
+  std::vector<long> sums(threads);
+  auto t0 = std::chrono::steady_clock::now();
+  for(unsigned t = 0; t < threads; ++t)
+    vt.emplace_back([&, t] {
+      long sum = 0;
+      for(const std::string &line : lines)
+        sum += parse(line);
+      sums[t] = sum;
+    });
+  for(auto &t : vt)
+    t.join();
+  return ns(std::chrono::steady_clock::now() - t0).count() / static_cast<double>(lines.size() * threads);
+}
+
+int main() {
+  /* 单子操作组合：解析、校验、换算，任何一步失败都短路 */
+  auto describe = [](std::string_view line) {
+    return parse_record(line)
+        .and_then([](record r) -> expected<record, parse_error> {
+          if(r.value < 0)
+            return unexpected(parse_error::overflow);
+          return r;
+        })
+        .transform([](record r) { return std::to_string(r.key) + " -> " + std::to_string(r.value); })
+        .transform_error([](parse_error e) { return std::string("error: ") + to_string(e); })
+        .or_else([](const std::string &msg) -> expected<std::string, std::string> { return msg + " (ignored)"; })
+        .value();
+  };
+  for(std::string_view line : {"7=42", "7=4x", "742", "=1", "1=99999999999"})
+    std::cout << std::setw(16) << line << "  " << describe(line) << "\n";
+
+  try {
+    parse_int("abc").value();
+  } catch(const expect::bad_expected_access<parse_error> &e) {
+    std::cout << "value() on error throws: " << to_string(e.error()) << "\n";
+  }
+
+  constexpr std::size_t n = 200000;
+  unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+  std::cout << "\nns per line (" << hw << " hardware threads)\n"
+            << "failure   threads    expected   exception\n";
+  for(double rate : {0.0, 0.01, 0.1, 0.5}) {
+    std::vector<std::string> lines = make_input(n, rate);
+    for(unsigned threads = 1; threads <= std::max(4u, hw) && threads <= 8; threads *= 2) {
+      double t_exp = run(lines, threads, [](const std::string &line) -> long {
+        auto r = parse_record(line);
+        return r ? r->value : -1;
+      });
+      double t_exc = run(lines, threads, [](const std::string &line) -> long {
+        try {
+          return parse_record_throw(line).value;
+        } catch(const parse_failure&) {
+          return -1;
+        }
+      });
+      std::cout << std::setw(6) << static_cast<int>(rate * 100) << "%  " << std::setw(8) << threads << std::fixed << std::setprecision(1)
+                << std::setw(12) << t_exp << std::setw(12) << t_exc << "\n";
+      std::cout.unsetf(std::ios::fixed);
+    }
+  }
+}
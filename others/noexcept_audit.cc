@@ -0,0 +1,173 @@
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief noexcept 移动审计
+ * noexcept.cc 只展示了 noexcept 操作符本身；真正的代价出现在容器里：
+ * std::vector 扩容时通过 std::move_if_noexcept 搬运旧元素，只有移动构造函数是 noexcept 的才会移动，
+ * 否则为了强异常安全保证退回到拷贝，每次扩容都把所有的字符串、数组重新深拷贝一遍
+ *
+ * 常见的“悄悄失去 noexcept”的写法：
+ * 1. 手写移动构造函数但忘了 noexcept（move_semantics.cc 中的 class A 原来就是这样）
+ * 2. 声明了析构函数（哪怕是空的），编译器不再生成移动构造函数，“移动”实际上是拷贝
+ * 3. 成员的移动构造函数不是 noexcept，例如 libstdc++ 的 std::deque（移动时要分配新的哨兵节点）
+ *
+ * 工具：
+ * 1. NOEXCEPT_AUDIT(T...)：编译期检查，任何一个型别不能 noexcept 移动构造/移动赋值/析构时编译失败，
+ *    诊断信息中会出现 require_nothrow_move<出问题的型别>
+ * 2. print_audit<T...>(os)：运行时打印每个型别的审计结果，以及 vector 扩容时会用移动还是拷贝
+ */
+
+namespace noexcept_audit {
+
+/* 从 __PRETTY_FUNCTION__ 中取出型别名 */
+template<typename T>
+std::string_view type_name() {
+  std::string_view s = __PRETTY_FUNCTION__;
+  std::size_t begin = s.find("T = ") + 4;
+  std::size_t end = s.find_first_of(";]", begin);
+  return s.substr(begin, end - begin);
+}
+
+template<typename T>
+struct traits {
+  static constexpr bool move_construct = std::is_nothrow_move_constructible_v<T>;
+  static constexpr bool move_assign = std::is_nothrow_move_assignable_v<T>;
+  static constexpr bool destroy = std::is_nothrow_destructible_v<T>;
+  static constexpr bool ok = move_construct && move_assign && destroy;
+  /* 与 std::move_if_noexcept 的选择一致 */
+  static constexpr bool vector_copies = !move_construct && std::is_copy_constructible_v<T>;
+};
+
+/* 每个型别单独实例化，失败时诊断信息中带有型别名 */
+template<typename T>
+struct require_nothrow_move {
+  static_assert(traits<T>::move_construct, "move constructor is not noexcept: std::vector copies on reallocation");
+  static_assert(traits<T>::move_assign, "move assignment is not noexcept");
+  static_assert(traits<T>::destroy, "destructor may throw");
+  static constexpr bool value = traits<T>::ok;
+};
+
+template<typename... Ts>
+constexpr bool check() { return (true && ... && require_nothrow_move<Ts>::value); }
+
+template<typename... Ts>
+void print_audit(std::ostream &os) {
+  auto yes = [](bool b) { return b ? "yes" : "NO"; };
+  os << "  move ctor  move assign  dtor   vector growth  type\n";
+  ((os << "  " << std::setw(9) << yes(traits<Ts>::move_construct) << "  " << std::setw(11) << yes(traits<Ts>::move_assign)
+       << "  " << std::setw(4) << yes(traits<Ts>::destroy) << "   " << std::setw(13)
+       << (traits<Ts>::move_construct ? "move" : traits<Ts>::vector_copies ? "COPY" : "throwing move")
+       << "  " << type_name<Ts>() << "\n"), ...);
+}
+
+}  // namespace noexcept_audit
+
+#define NOEXCEPT_AUDIT(...) static_assert(noexcept_audit::check<__VA_ARGS__>(), "noexcept move audit failed")
+
+/* ------------------------------ 被审计的型别 ------------------------------ */
+
+/* move_semantics.cc 中 class A 原来的写法：移动构造函数没有 noexcept，拷贝构造函数的参数是非 const 引用 */
+class legacy_A {
+public:
+  int *pointer;
+  legacy_A() : pointer(new int(1)) {}
+  legacy_A(legacy_A &a) : pointer(new int(*a.pointer)) {}
+  legacy_A(legacy_A &&a) : pointer(a.pointer) { a.pointer = nullptr; }
+  ~legacy_A() { delete pointer; }
+};
+
+struct order {
+  std::string symbol;
+  std::vector<int> fills;
+  double price = 0;
+};
+
+/* 空的析构函数让编译器不再生成移动操作 */
+struct order_with_dtor {
+  std::string symbol;
+  std::vector<int> fills;
+  ~order_with_dtor() {}
+};
+
+struct order_with_deque {
+  std::string symbol;
+  std::deque<int> fills;
+};
+
+NOEXCEPT_AUDIT(order, std::string, std::vector<order>);
+#ifdef AUDIT_LEGACY
+/* 打开后编译失败，错误信息列出每一个不合格的型别 */
+NOEXCEPT_AUDIT(legacy_A, order_with_dtor, order_with_deque);
+#endif
+
+/* ------------------------------ 扩容测试 ------------------------------ */
+static long g_copies = 0;
+static long g_moves = 0;
+
+/* 记录拷贝和移动次数的成员，本身的操作都是 noexcept 的，不影响外层型别的审计结果 */
+struct probe {
+  probe() noexcept = default;
+  probe(const probe&) noexcept { ++g_copies; }
+  probe(probe&&) noexcept { ++g_moves; }
+  probe& operator=(const probe&) noexcept { ++g_copies; return *this; }
+  probe& operator=(probe&&) noexcept { ++g_moves; return *this; }
+};
+
+/* 字符串超过 SSO 的长度，拷贝需要分配内存 */
+struct payload {
+  std::string name = "a reasonably long instrument identifier";
+  std::vector<int> data = std::vector<int>(8);
+  probe p;
+};
+
+struct payload_throwing_move : payload {
+  payload_throwing_move() = default;
+  payload_throwing_move(const payload_throwing_move&) = default;
+  payload_throwing_move(payload_throwing_move &&o) : payload(std::move(o)) {}
+  payload_throwing_move& operator=(const payload_throwing_move&) = default;
+  payload_throwing_move& operator=(payload_throwing_move&&) = default;
+};
+
+struct payload_with_dtor : payload {
+  ~payload_with_dtor() {}
+};
+
+using ms = std::chrono::duration<double, std::milli>;
+
+template<typename T>
+void grow(const char *name, std::size_t n) {
+  g_copies = g_moves = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  {
+    std::vector<T> v;
+    for(std::size_t i = 0; i < n; ++i)
+      v.emplace_back();
+  }
+  double t = ms(std::chrono::steady_clock::now() - t0).count();
+  std::cout << "  " << std::setw(22) << name << std::setw(9) << std::fixed << std::setprecision(1) << t << " ms   "
+            << std::setw(8) << g_copies << " copies " << std::setw(8) << g_moves << " moves\n";
+  std::cout.unsetf(std::ios::fixed);
+}
+
+int main() {
+  std::cout << "audit:\n";
+  noexcept_audit::print_audit<legacy_A, order, order_with_dtor, order_with_deque, std::deque<int>,
+                              payload, payload_throwing_move, payload_with_dtor>(std::cout);
+
+  constexpr std::size_t n = 1 << 20;
+  std::cout << "\nvector growth, " << n << " emplace_back without reserve:\n";
+  for(int round = 0; round < 2; ++round) {
+    grow<payload>("noexcept move", n);
+    grow<payload_throwing_move>("move without noexcept", n);
+    grow<payload_with_dtor>("user-declared dtor", n);
+  }
+}
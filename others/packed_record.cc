@@ -0,0 +1,494 @@
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 编译期重排字段以减少填充
+ * memory_align.cc 中的 Storage 说明了字段的声明顺序决定了填充的多少；字段一多，手工排序既容易出错，
+ * 又会打乱按含义分组的声明顺序。packed_record 按声明顺序接收字段，在编译期重新安排它们的位置：
+ *
+ * 1. 字段按对齐从大到小排列（对齐相同时保持声明顺序），除了结尾补齐之外不会产生填充
+ * 2. 访问方式不变：r.get<price>() 按名字访问，r.get<1>() 按声明下标访问
+ * 3. 冷热分离：cold<F> 标记的字段放在单独分配的冷数据块里，记录本身只多一个指针；
+ *    冷数据块在第一次写入冷字段时才分配，从未写过冷字段的记录不会分配
+ * 4. layout() / declared_layout() / cold_layout() 都是 constexpr 的，可以直接写进 static_assert：
+ *    大小、对齐、填充字节数、缓存行数（从缓存行开头放置 / 最坏位置）
+ *
+ * 字段用 PACKED_FIELD(名字, 类型) 声明，名字本身是一个标签类型
+ */
+
+#define PACKED_FIELD(Name, ...)                   \
+  struct Name {                                   \
+    using type = __VA_ARGS__;                     \
+    static constexpr const char *name = #Name;    \
+  }
+
+namespace layout {
+
+constexpr std::size_t kCacheLine = 64;
+
+struct report {
+  std::size_t size;
+  std::size_t align;
+  std::size_t field_bytes;
+  std::size_t padding;
+  std::size_t cache_lines;        // 对象从缓存行开头放置时覆盖的缓存行数
+  std::size_t cache_lines_worst;  // 对象只满足自身对齐时最多覆盖的缓存行数
+};
+
+template<typename F>
+struct cold {};
+
+template<typename F>
+struct field_traits {
+  using tag = F;
+  static constexpr bool is_cold = false;
+};
+
+template<typename F>
+struct field_traits<cold<F>> {
+  using tag = F;
+  static constexpr bool is_cold = true;
+};
+
+constexpr std::size_t align_up(std::size_t v, std::size_t a) { return (v + a - 1) / a * a; }
+
+/* 一组字段的布局规划，所有的数组都按声明下标索引 */
+template<typename... Fs>
+struct plan {
+  using index_array = std::array<std::size_t, sizeof...(Fs)>;
+  static constexpr std::size_t n = sizeof...(Fs);
+  static constexpr index_array sizes{{sizeof(typename Fs::type)...}};
+  static constexpr index_array aligns{{alignof(typename Fs::type)...}};
+  static constexpr std::array<const char*, n> names{{Fs::name...}};
+
+  static constexpr index_array declared_order() {
+    index_array o{};
+    for(std::size_t i = 0; i < n; ++i)
+      o[i] = i;
+    return o;
+  }
+
+  /* 插入排序，对齐大的在前，稳定 */
+  static constexpr index_array sorted_order() {
+    index_array o = declared_order();
+    for(std::size_t i = 1; i < n; ++i)
+      for(std::size_t j = i; j > 0 && aligns[o[j - 1]] < aligns[o[j]]; --j) {
+        std::size_t t = o[j];
+        o[j] = o[j - 1];
+        o[j - 1] = t;
+      }
+    return o;
+  }
+
+  static constexpr index_array offsets_for(const index_array &order) {
+    index_array off{};
+    std::size_t pos = 0;
+    for(std::size_t k = 0; k < n; ++k) {
+      std::size_t i = order[k];
+      pos = align_up(pos, aligns[i]);
+      off[i] = pos;
+      pos += sizes[i];
+    }
+    return off;
+  }
+
+  static constexpr report report_for(const index_array &order) {
+    index_array off = offsets_for(order);
+    std::size_t align = 1, end = 0, bytes = 0;
+    for(std::size_t i = 0; i < n; ++i) {
+      align = aligns[i] > align ? aligns[i] : align;
+      end = off[i] + sizes[i] > end ? off[i] + sizes[i] : end;
+      bytes += sizes[i];
+    }
+    std::size_t size = align_up(end, align);
+    std::size_t worst_start = align < kCacheLine ? kCacheLine - align : 0;
+    return {size, align, bytes, size - bytes,
+            align_up(size, kCacheLine) / kCacheLine,
+            size == 0 ? 0 : align_up(worst_start + size, kCacheLine) / kCacheLine};
+  }
+
+  static constexpr index_array order = sorted_order();
+  static constexpr index_array offsets = offsets_for(order);
+  static constexpr report packed = report_for(order);
+  static constexpr report declared = report_for(declared_order());
+};
+
+/* 按 plan 计算出的偏移把字段放进一块原始内存 */
+template<typename... Fs>
+class packed_storage {
+public:
+  using plan_type = plan<Fs...>;
+  template<std::size_t I>
+  using type_at = typename std::tuple_element_t<I, std::tuple<Fs...>>::type;
+
+  packed_storage() {
+    construct(seq{}, [this](auto i) {
+      constexpr std::size_t I = decltype(i)::value;
+      new (raw<I>()) type_at<I>();
+    });
+  }
+  packed_storage(const packed_storage &o) {
+    construct(seq{}, [this, &o](auto i) {
+      constexpr std::size_t I = decltype(i)::value;
+      new (raw<I>()) type_at<I>(o.template get<I>());
+    });
+  }
+  packed_storage(packed_storage &&o) noexcept(std::conjunction_v<std::is_nothrow_move_constructible<typename Fs::type>...>) {
+    construct(seq{}, [this, &o](auto i) {
+      constexpr std::size_t I = decltype(i)::value;
+      new (raw<I>()) type_at<I>(std::move(o.template get<I>()));
+    });
+  }
+  packed_storage& operator=(const packed_storage &o) {
+    assign(seq{}, o);
+    return *this;
+  }
+  packed_storage& operator=(packed_storage &&o) noexcept(std::conjunction_v<std::is_nothrow_move_assignable<typename Fs::type>...>) {
+    move_assign(seq{}, o);
+    return *this;
+  }
+  ~packed_storage() { destroy_first(seq{}, sizeof...(Fs)); }
+
+  template<std::size_t I>
+  type_at<I>& get() noexcept {
+    return *std::launder(reinterpret_cast<type_at<I>*>(buf + plan_type::offsets[I]));
+  }
+  template<std::size_t I>
+  const type_at<I>& get() const noexcept {
+    return *std::launder(reinterpret_cast<const type_at<I>*>(buf + plan_type::offsets[I]));
+  }
+
+private:
+  using seq = std::index_sequence_for<Fs...>;
+
+  /* 按声明顺序逐个构造，某个字段的构造函数抛出异常时析构已经构造好的字段 */
+  template<std::size_t... I, typename Make>
+  void construct(std::index_sequence<I...>, Make make) {
+    std::size_t built = 0;
+    try {
+      ((make(std::integral_constant<std::size_t, I>{}), ++built), ...);
+    } catch(...) {
+      destroy_first(seq{}, built);
+      throw;
+    }
+  }
+
+  template<std::size_t... I>
+  void assign(std::index_sequence<I...>, const packed_storage &o) { ((get<I>() = o.template get<I>()), ...); }
+  template<std::size_t... I>
+  void move_assign(std::index_sequence<I...>, packed_storage &o) { ((get<I>() = std::move(o.template get<I>())), ...); }
+
+  template<std::size_t... I>
+  void destroy_first(std::index_sequence<I...>, std::size_t count) noexcept {
+    ((I < count ? std::destroy_at(&get<I>()) : void()), ...);
+  }
+
+  template<std::size_t I>
+  type_at<I>* raw() noexcept { return reinterpret_cast<type_at<I>*>(buf + plan_type::offsets[I]); }
+
+  static constexpr std::size_t kAlign = plan_type::packed.align;
+  static constexpr std::size_t kSize = plan_type::packed.size ? plan_type::packed.size : 1;
+  alignas(kAlign) unsigned char buf[kSize];
+};
+
+/* 冷数据块的指针：拷贝时深拷贝，第一次写访问时才分配，只读访问未分配的块时看到的是默认值 */
+template<typename S>
+class cold_ptr {
+public:
+  cold_ptr() = default;
+  cold_ptr(const cold_ptr &o) : p(o.p ? std::make_unique<S>(*o.p) : nullptr) {}
+  cold_ptr(cold_ptr&&) noexcept = default;
+  cold_ptr& operator=(const cold_ptr &o) {
+    if(this != &o)
+      p = o.p ? std::make_unique<S>(*o.p) : nullptr;
+    return *this;
+  }
+  cold_ptr& operator=(cold_ptr&&) noexcept = default;
+
+  S& get() {
+    if(!p)
+      p = std::make_unique<S>();
+    return *p;
+  }
+  const S& get() const {
+    static const S defaults;
+    return p ? *p : defaults;
+  }
+  explicit operator bool() const noexcept { return p != nullptr; }
+
+private:
+  std::unique_ptr<S> p;
+};
+
+template<typename S>
+struct cold_link {
+  using type = cold_ptr<S>;
+  static constexpr const char *name = "(cold block)";
+};
+
+template<bool Cold, typename D>
+using pick = std::conditional_t<field_traits<D>::is_cold == Cold, std::tuple<typename field_traits<D>::tag>, std::tuple<>>;
+
+template<typename Tuple, typename... Extra>
+struct storage_of;
+template<typename... Fs, typename... Extra>
+struct storage_of<std::tuple<Fs...>, Extra...> {
+  using type = packed_storage<Fs..., Extra...>;
+};
+
+template<typename... Decl>
+class packed_record {
+  static constexpr std::size_t n = sizeof...(Decl);
+  static constexpr std::array<bool, n> cold_flags{{field_traits<Decl>::is_cold...}};
+  static constexpr std::size_t n_cold = (std::size_t(0) + ... + field_traits<Decl>::is_cold);
+
+  using cold_storage = typename storage_of<decltype(std::tuple_cat(std::declval<pick<true, Decl>>()...))>::type;
+  using hot_tuple = decltype(std::tuple_cat(std::declval<pick<false, Decl>>()...));
+  /* 有冷字段时，指向冷数据块的指针作为最后一个热字段参与排序 */
+  using hot_storage = std::conditional_t<n_cold == 0, typename storage_of<hot_tuple>::type,
+                                         typename storage_of<hot_tuple, cold_link<cold_storage>>::type>;
+  static constexpr std::size_t link_slot = n - n_cold;
+
+  /* 声明下标为 i 的字段在热（或冷）部分中的下标 */
+  static constexpr std::size_t slot(std::size_t i) {
+    std::size_t k = 0;
+    for(std::size_t j = 0; j < i; ++j)
+      k += cold_flags[j] == cold_flags[i];
+    return k;
+  }
+
+public:
+  template<typename Tag>
+  static constexpr std::size_t index_of() {
+    constexpr bool match[] = {std::is_same_v<Tag, typename field_traits<Decl>::tag>..., false};
+    static_assert((std::size_t(0) + ... + std::is_same_v<Tag, typename field_traits<Decl>::tag>) == 1,
+                  "field must appear exactly once in the record");
+    std::size_t i = 0;
+    while(!match[i])
+      ++i;
+    return i;
+  }
+
+  template<std::size_t I>
+  decltype(auto) get() {
+    static_assert(I < n, "field index out of range");
+    if constexpr(cold_flags[I])
+      return cold().template get<slot(I)>();
+    else
+      return hot.template get<slot(I)>();
+  }
+  template<std::size_t I>
+  decltype(auto) get() const {
+    static_assert(I < n, "field index out of range");
+    if constexpr(cold_flags[I])
+      return cold().template get<slot(I)>();
+    else
+      return hot.template get<slot(I)>();
+  }
+  template<typename Tag>
+  decltype(auto) get() { return get<index_of<Tag>()>(); }
+  template<typename Tag>
+  decltype(auto) get() const { return get<index_of<Tag>()>(); }
+
+  /* 是否已经分配了冷数据块 */
+  bool has_cold() const noexcept {
+    if constexpr(n_cold == 0)
+      return false;
+    else
+      return static_cast<bool>(hot.template get<link_slot>());
+  }
+
+  /* 记录本身（热字段和冷数据块指针）的布局 */
+  static constexpr report layout() { return hot_storage::plan_type::packed; }
+  /* 冷数据块的布局，没有冷字段时大小为 0 */
+  static constexpr report cold_layout() { return cold_storage::plan_type::packed; }
+  /* 同样的字段全部按声明顺序放在一个普通结构体中的布局 */
+  static constexpr report declared_layout() { return plan<typename field_traits<Decl>::tag...>::declared; }
+
+  template<typename Tag>
+  static constexpr bool is_cold() { return cold_flags[index_of<Tag>()]; }
+  template<typename Tag>
+  static constexpr std::size_t offset_of() {
+    constexpr std::size_t i = index_of<Tag>();
+    if constexpr(cold_flags[i])
+      return cold_storage::plan_type::offsets[slot(i)];
+    else
+      return hot_storage::plan_type::offsets[slot(i)];
+  }
+
+  /* 按内存中的位置打印每个字段 */
+  static void print_layout(std::ostream &os) {
+    print_part<hot_storage>(os, "record");
+    if constexpr(n_cold != 0)
+      print_part<cold_storage>(os, "cold block");
+    report d = declared_layout();
+    os << "  declared order would be " << d.size << " bytes with " << d.padding << " bytes of padding\n";
+  }
+
+private:
+  template<typename S>
+  static void print_part(std::ostream &os, const char *what) {
+    using P = typename S::plan_type;
+    os << "  " << what << ": " << P::packed.size << " bytes, align " << P::packed.align << ", padding "
+       << P::packed.padding << ", cache lines " << P::packed.cache_lines << " (worst "
+       << P::packed.cache_lines_worst << ")\n";
+    for(std::size_t k = 0; k < P::n; ++k) {
+      std::size_t i = P::order[k];
+      os << "    " << std::setw(4) << P::offsets[i] << "  " << std::setw(3) << P::sizes[i] << "  " << P::names[i] << "\n";
+    }
+  }
+
+  cold_storage& cold() { return hot.template get<link_slot>().get(); }
+  const cold_storage& cold() const { return hot.template get<link_slot>().get(); }
+
+  hot_storage hot;
+};
+
+}  // namespace layout
+
+/* ------------------------------ 测试 ------------------------------ */
+using layout::cold;
+using layout::packed_record;
+
+/* memory_align.cc 中的 Storage：已经是对齐递增的顺序，重排之后大小不变 */
+namespace storage_fields {
+PACKED_FIELD(a, char);
+PACKED_FIELD(b, int);
+PACKED_FIELD(c, double);
+PACKED_FIELD(d, long long);
+}  // namespace storage_fields
+
+using packed_storage_t = packed_record<storage_fields::a, storage_fields::b, storage_fields::c, storage_fields::d>;
+static_assert(packed_storage_t::layout().size == 24 && packed_storage_t::layout().padding == 3, "");
+static_assert(packed_storage_t::declared_layout().size == 24, "");
+
+/* 按业务含义声明的订单记录：扫描时只用前 6 个字段，后面的字段很少访问 */
+namespace order_fields {
+PACKED_FIELD(side, char);
+PACKED_FIELD(price, double);
+PACKED_FIELD(status, std::uint8_t);
+PACKED_FIELD(order_id, std::uint64_t);
+PACKED_FIELD(flags, std::uint16_t);
+PACKED_FIELD(qty, std::int32_t);
+PACKED_FIELD(account, std::array<char, 16>);
+PACKED_FIELD(created_ns, std::int64_t);
+PACKED_FIELD(venue, std::array<char, 8>);
+PACKED_FIELD(note, std::string);
+PACKED_FIELD(revision, std::uint16_t);
+PACKED_FIELD(trader_id, std::uint32_t);
+}  // namespace order_fields
+
+namespace of = order_fields;
+
+struct order_plain {
+  char side;
+  double price;
+  std::uint8_t status;
+  std::uint64_t order_id;
+  std::uint16_t flags;
+  std::int32_t qty;
+  std::array<char, 16> account;
+  std::int64_t created_ns;
+  std::array<char, 8> venue;
+  std::string note;
+  std::uint16_t revision;
+  std::uint32_t trader_id;
+};
+
+/* 全部字段内联，只重排 */
+using order_sorted = packed_record<of::side, of::price, of::status, of::order_id, of::flags, of::qty,
+                                   of::account, of::created_ns, of::venue, of::note, of::revision, of::trader_id>;
+/* 重排并把很少访问的字段移出 */
+using order_split = packed_record<of::side, of::price, of::status, of::order_id, of::flags, of::qty,
+                                  cold<of::account>, cold<of::created_ns>, cold<of::venue>, cold<of::note>,
+                                  cold<of::revision>, cold<of::trader_id>>;
+
+static_assert(order_sorted::declared_layout().size == sizeof(order_plain), "plan must agree with the compiler");
+static_assert(sizeof(order_sorted) == order_sorted::layout().size, "");
+static_assert(sizeof(order_split) == order_split::layout().size, "");
+static_assert(order_sorted::layout().padding < order_sorted::declared_layout().padding, "");
+static_assert(order_split::layout().size == 32 && order_split::layout().cache_lines == 1, "hot part fits one line");
+static_assert(order_split::is_cold<of::note>() && !order_split::is_cold<of::price>(), "");
+static_assert(order_split::index_of<of::qty>() == 5, "");
+
+using ms = std::chrono::duration<double, std::milli>;
+
+constexpr std::size_t kOrders = 1 << 20;
+constexpr int kRounds = 20;
+
+template<typename R>
+void fill(R &r, std::size_t i) {
+  r.template get<of::side>() = i & 1 ? 'B' : 'S';
+  r.template get<of::price>() = 100.0 + static_cast<double>(i % 1000) / 100;
+  r.template get<of::status>() = static_cast<std::uint8_t>(i % 3);
+  r.template get<of::order_id>() = i;
+  r.template get<of::qty>() = static_cast<std::int32_t>(i % 500 + 1);
+}
+
+void fill(order_plain &r, std::size_t i) {
+  r.side = i & 1 ? 'B' : 'S';
+  r.price = 100.0 + static_cast<double>(i % 1000) / 100;
+  r.status = static_cast<std::uint8_t>(i % 3);
+  r.order_id = i;
+  r.qty = static_cast<std::int32_t>(i % 500 + 1);
+}
+
+double notional(const order_plain &r) { return r.status == 1 && r.side == 'B' ? r.price * r.qty : 0; }
+
+template<typename R>
+double notional(const R &r) {
+  return r.template get<of::status>() == 1 && r.template get<of::side>() == 'B'
+             ? r.template get<of::price>() * r.template get<of::qty>() : 0;
+}
+
+template<typename R>
+void bench(const char *name) {
+  std::vector<R> orders(kOrders);
+  for(std::size_t i = 0; i < kOrders; ++i)
+    fill(orders[i], i);
+
+  double sum = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for(int round = 0; round < kRounds; ++round)
+    for(const R &r : orders)
+      sum += notional(r);
+  double t = ms(std::chrono::steady_clock::now() - t0).count();
+  std::cout << std::setw(12) << name << ": " << std::setw(3) << sizeof(R) << " bytes/record, "
+            << std::setw(4) << sizeof(R) * kOrders / (1 << 20) << " MiB, " << std::setw(7) << std::fixed
+            << std::setprecision(1) << t / kRounds << " ms/scan  (sum " << sum << ")\n";
+  std::cout.unsetf(std::ios::fixed);
+}
+
+int main() {
+  std::cout << "Storage from memory_align.cc:\n";
+  packed_storage_t::print_layout(std::cout);
+
+  std::cout << "\norder record, all fields inline:\n";
+  order_sorted::print_layout(std::cout);
+  std::cout << "\norder record, rarely used fields out of line:\n";
+  order_split::print_layout(std::cout);
+
+  /* 按名字和按下标访问的是同一个字段；只读冷字段不会分配冷数据块 */
+  order_split r;
+  r.get<of::price>() = 101.5;
+  std::cout << "\nget<price>() = " << r.get<1>() << ", note = \"" << std::as_const(r).get<of::note>()
+            << "\", cold block allocated: " << std::boolalpha << r.has_cold() << "\n";
+  r.get<of::note>() = "manual amend";
+  order_split copy = r;
+  std::cout << "after writing note: allocated " << r.has_cold() << ", copy sees \"" << copy.get<of::note>() << "\"\n\n";
+
+  bench<order_plain>("declared");
+  bench<order_sorted>("sorted");
+  bench<order_split>("hot/cold");
+}
@@ -0,0 +1,105 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "rcu_snapshot.h"
+
+/**
+ * @brief rcu_snapshot.h 的使用，以及和 std::atomic_load(shared_ptr)、mutex + shared_ptr 在多个读线程下的读取吞吐对比
+ */
+
+struct Config {
+  std::string name;
+  int version;
+  long long threshold;
+};
+
+/**
+ * @brief 读线程持续读取配置，一个写线程每 1ms 发布一次新的配置
+ * 返回所有读线程的总读取次数
+ */
+template<typename Read, typename Write>
+double bench(int readers, Read read, Write write) {
+  std::atomic<bool> stop{false};
+  std::atomic<long long> total{0};
+  std::vector<std::thread> vt;
+  for(int i = 0; i < readers; ++i) {
+    vt.emplace_back([&] {
+      long long n = 0, sink = 0;
+      while(!stop.load(std::memory_order_relaxed)) {
+        sink += read();
+        ++n;
+      }
+      total += n + (sink == -1);
+    });
+  }
+  std::thread writer([&] {
+    for(int v = 0; !stop.load(std::memory_order_relaxed); ++v) {
+      write(v);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  stop = true;
+  for(auto &t : vt)
+    t.join();
+  writer.join();
+  return total / 0.3 / 1e6;
+}
+
+int main() {
+  rcu_snapshot<Config> config(std::make_unique<Config>(Config{"default", 1, 100}));
+  {
+    auto snap = config.read();
+    std::cout << "config: " << snap->name << " v" << snap->version << "\n";
+  }
+  config.store(std::make_unique<Config>(Config{"updated", 2, 200}));
+  config.synchronize();
+  std::cout << "config: " << config.read()->name << " v" << config.read()->version << "\n\n";
+
+  for(int readers : {1, 2, 4, 8}) {
+    std::cout << readers << " readers (Mreads/s):\n";
+
+    auto sp = std::make_shared<Config>(Config{"cfg", 0, 0});
+    double r1 = bench(readers,
+        [&] { return std::atomic_load(&sp)->threshold; },
+        [&](int v) { std::atomic_store(&sp, std::make_shared<Config>(Config{"cfg", v, v})); });
+    std::cout << "  std::atomic_load(shared_ptr): " << r1 << "\n";
+
+#if defined(__cpp_lib_atomic_shared_ptr)
+    std::atomic<std::shared_ptr<Config>> asp(std::make_shared<Config>(Config{"cfg", 0, 0}));
+    double r2 = bench(readers,
+        [&] { return asp.load()->threshold; },
+        [&](int v) { asp.store(std::make_shared<Config>(Config{"cfg", v, v})); });
+    std::cout << "  std::atomic<shared_ptr>:      " << r2 << "\n";
+#endif
+
+    std::mutex mtx;
+    auto msp = std::make_shared<Config>(Config{"cfg", 0, 0});
+    double r3 = bench(readers,
+        [&] {
+          std::shared_ptr<Config> copy;
+          {
+            std::lock_guard<std::mutex> lock(mtx);
+            copy = msp;
+          }
+          return copy->threshold;
+        },
+        [&](int v) {
+          auto next = std::make_shared<Config>(Config{"cfg", v, v});
+          std::lock_guard<std::mutex> lock(mtx);
+          msp = std::move(next);
+        });
+    std::cout << "  mutex + shared_ptr:           " << r3 << "\n";
+
+    rcu_snapshot<Config> rcu(std::make_unique<Config>(Config{"cfg", 0, 0}));
+    double r4 = bench(readers,
+        [&] { return rcu.read()->threshold; },
+        [&](int v) { rcu.store(std::make_unique<Config>(Config{"cfg", v, v})); });
+    std::cout << "  rcu_snapshot:                 " << r4 << "\n";
+  }
+}
@@ -0,0 +1,116 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "cycle_collector.h"
+
+/**
+ * @brief cycle_collector.h 的使用：weak_ptr.cc 中的环改用 tracked_ptr，泄漏报告，以及和 shared_ptr 的开销对比
+ */
+
+struct B;
+
+struct A {
+  tracked_ptr<B> pointer;
+  ~A() {
+    std::cout << "A 被销毁\n";
+  }
+};
+
+struct B {
+  tracked_ptr<A> pointer;
+  ~B() {
+    std::cout << "B 被销毁\n";
+  }
+};
+
+struct Node {
+  tracked_ptr<Node> next;
+  int payload[4];
+};
+
+int main() {
+  auto &heap = gc_heap::instance();
+
+  /* 与 weak_ptr.cc 中相同的 A <-> B 环，离开作用域后两个对象都还在 */
+  {
+    auto a = make_tracked(A);
+    auto b = make_tracked(B);
+    a->pointer = b;
+    b->pointer = a;
+    std::cout << "a.use_count(): " << a.use_count() << "\n";
+    std::cout << "b.use_count(): " << b.use_count() << "\n";
+  }
+  std::cout << "out scope, candidates: " << heap.candidates() << "\n";
+  std::cout << "collect: " << heap.collect() << " objects freed\n";
+
+  /* 仍被外部引用的环不会被回收 */
+  {
+    auto a = make_tracked(A);
+    a->pointer = make_tracked(B);
+    a->pointer->pointer = a;
+    auto keep = a->pointer;
+    a.reset();
+    std::cout << "reachable cycle, collect: " << heap.collect() << " objects freed\n";
+  }
+  heap.collect();
+
+  /* 自赋值：对象和引用计数都保持不变 */
+  {
+    auto a = make_tracked(A);
+    auto &alias = a;
+    a = alias;
+    std::cout << "self-assignment: a " << (a ? "alive" : "lost") << ", use_count " << a.use_count() << "\n";
+  }
+  std::cout << "\nleak report:\n";
+  heap.report(std::cout);
+
+  /* 每个指针操作的开销：与 shared_ptr 比较拷贝 + 析构 */
+  constexpr int kIters = 10000000;
+  {
+    auto sp = std::make_shared<Node>();
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < kIters; ++i) {
+      auto copy = sp;
+      asm volatile("" : : "r"(copy.get()) : "memory");
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "\nshared_ptr  copy+destroy: "
+              << std::chrono::duration<double, std::nano>(end - start).count() / kIters << " ns\n";
+  }
+  {
+    auto tp = make_tracked(Node);
+    auto start = std::chrono::steady_clock::now();
+    for(int i = 0; i < kIters; ++i) {
+      auto copy = tp;
+      asm volatile("" : : "r"(copy.get()) : "memory");
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "tracked_ptr copy+destroy: "
+              << std::chrono::duration<double, std::nano>(end - start).count() / kIters << " ns\n";
+  }
+  heap.collect();
+  std::cout << "per-object header: gc_node " << sizeof(gc_node)
+            << " B, sizeof(tracked_ptr) " << sizeof(tracked_ptr<Node>)
+            << " B, sizeof(shared_ptr) " << sizeof(std::shared_ptr<Node>) << " B\n";
+
+  /* 暂停时间：制造若干个长度为 kRing 的环，然后一次性回收 */
+  for(int rings : {1000, 10000, 100000}) {
+    constexpr int kRing = 8;
+    for(int r = 0; r < rings; ++r) {
+      auto head = make_tracked(Node);
+      auto cur = head;
+      for(int i = 1; i < kRing; ++i) {
+        cur->next = make_tracked(Node);
+        cur = cur->next;
+      }
+      cur->next = head;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::size_t freed = heap.collect();
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "collect " << freed << " objects in "
+              << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+  }
+}
@@ -0,0 +1,373 @@
+#ifndef CYCLE_COLLECTOR_H
+#define CYCLE_COLLECTOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <map>
+#include <new>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief shared_ptr 循环引用的回收
+ * weak_ptr.cc 中 A 和 B 互相持有对方的 shared_ptr，离开作用域之后引用计数都停留在 1，永远不会被销毁
+ * 长期运行的进程里，整个对象图都会以这种方式泄漏
+ *
+ * 这里实现一个带边登记的智能指针 tracked_ptr<T>，以及 Bacon–Rajan 风格的同步试删除（trial deletion）回收器
+ * 1. 每个对象有一个节点头 gc_node：引用计数、颜色、是否已在候选根缓冲区中、出边列表、分配位置
+ * 2. 引用计数减到 0：立即析构（和 shared_ptr 一样）
+ * 3. 引用计数减到非 0：这个对象可能是一个环的根，染成紫色放入候选根缓冲区
+ * 4. collect() 时对候选根做三遍扫描：
+ *    - mark_gray：从候选根出发，沿着出边把子节点的引用计数减 1（假装删除内部边）
+ *    - scan：试删除之后引用计数仍然大于 0 的节点说明有外部引用，scan_black 把它能到达的节点恢复；其余染白
+ *    - collect_white：白色节点就是只被环内部引用的垃圾，统一释放，并按分配位置汇总报告
+ *
+ * 出边的登记：make_tracked 构造对象期间，把对象的节点压入 gc_heap::constructing 栈，
+ * 在这个范围内构造的 tracked_ptr 就是该对象的成员，登记为它的出边；其他位置（栈上、全局）的 tracked_ptr 只算外部引用
+ * 对象构造完成之后才放进容器的 tracked_ptr 不会被登记为边，这只会让回收器更保守（看不到的边等价于外部引用），不会误删
+ *
+ * 回收器不是线程安全的，所有 tracked_ptr 的操作和 collect() 需要在同一个线程里进行
+ */
+
+class gc_heap;
+
+enum class gc_color : unsigned char {
+  black,  // 正在使用或者空闲
+  gray,   // 可能是环的成员
+  white,  // 环的成员，垃圾
+  purple  // 候选根
+};
+
+class tracked_ptr_base;
+
+struct gc_node {
+  std::size_t rc = 1;
+  gc_color color = gc_color::black;
+  bool buffered = false;
+  std::vector<tracked_ptr_base*> edges;
+  const char *file;
+  int line;
+  const char *type;
+  void *object;
+  std::size_t object_size;
+  void (*destroy)(gc_node*);  // 析构对象
+  void (*free)(gc_node*);     // 释放节点和对象所在的内存
+};
+
+class tracked_ptr_base {
+public:
+  gc_node* node() const { return n; }
+
+protected:
+  tracked_ptr_base() { register_edge(); }
+  explicit tracked_ptr_base(gc_node *n) : n(n) { register_edge(); }
+
+  inline void register_edge();
+
+  gc_node *n = nullptr;
+  friend class gc_heap;
+};
+
+/* 全局的回收器状态 */
+class gc_heap {
+public:
+  struct site_stats {
+    std::size_t objects = 0;
+    std::size_t bytes = 0;
+  };
+
+  static gc_heap& instance() {
+    static gc_heap heap;
+    return heap;
+  }
+
+  void increment(gc_node *n) {
+    ++n->rc;
+    n->color = gc_color::black;
+  }
+
+  void decrement(gc_node *n) {
+    if(--n->rc == 0) {
+      release(n);
+    } else if(n->color != gc_color::purple) {
+      n->color = gc_color::purple;
+      if(!n->buffered) {
+        n->buffered = true;
+        roots.push_back(n);
+      }
+    }
+  }
+
+  /**
+   * @brief 执行一次回收，返回释放的对象个数
+   * 被回收的对象按照分配位置累计到 leaks 中，调用 report() 输出
+   */
+  std::size_t collect() {
+    mark_roots();
+    scan_roots();
+    return collect_roots();
+  }
+
+  void report(std::ostream &os) const {
+    for(auto &kv : leaks)
+      os << "  cycle garbage from " << kv.first << ": "
+         << kv.second.objects << " objects, " << kv.second.bytes << " bytes\n";
+  }
+
+  std::size_t candidates() const { return roots.size(); }
+
+  /* make_tracked 构造对象期间使用，用于判断 tracked_ptr 是否为对象的成员 */
+  std::vector<gc_node*> constructing;
+
+private:
+  void release(gc_node *n) {
+    n->color = gc_color::black;
+    n->destroy(n);  // 成员 tracked_ptr 析构时递减子节点
+    n->edges.clear();
+    if(!n->buffered)
+      n->free(n);
+    /* 仍在候选根缓冲区中的节点留到 mark_roots 中释放 */
+  }
+
+  void mark_roots() {
+    std::vector<gc_node*> kept;
+    for(gc_node *s : roots) {
+      if(s->color == gc_color::purple && s->rc > 0) {
+        mark_gray(s);
+        kept.push_back(s);
+      } else {
+        s->buffered = false;
+        if(s->color == gc_color::black && s->rc == 0)
+          s->free(s);
+      }
+    }
+    roots.swap(kept);
+  }
+
+  void mark_gray(gc_node *s) {
+    if(s->color == gc_color::gray)
+      return;
+    s->color = gc_color::gray;
+    std::vector<gc_node*> stack{s};
+    while(!stack.empty()) {
+      gc_node *n = stack.back();
+      stack.pop_back();
+      for(tracked_ptr_base *e : n->edges) {
+        gc_node *c = e->n;
+        if(c == nullptr)
+          continue;
+        --c->rc;
+        if(c->color != gc_color::gray) {
+          c->color = gc_color::gray;
+          stack.push_back(c);
+        }
+      }
+    }
+  }
+
+  void scan_roots() {
+    for(gc_node *s : roots)
+      scan(s);
+  }
+
+  void scan(gc_node *s) {
+    std::vector<gc_node*> stack{s};
+    while(!stack.empty()) {
+      gc_node *n = stack.back();
+      stack.pop_back();
+      if(n->color != gc_color::gray)
+        continue;
+      if(n->rc > 0) {
+        scan_black(n);
+        continue;
+      }
+      n->color = gc_color::white;
+      for(tracked_ptr_base *e : n->edges)
+        if(e->n != nullptr)
+          stack.push_back(e->n);
+    }
+  }
+
+  void scan_black(gc_node *s) {
+    s->color = gc_color::black;
+    std::vector<gc_node*> stack{s};
+    while(!stack.empty()) {
+      gc_node *n = stack.back();
+      stack.pop_back();
+      for(tracked_ptr_base *e : n->edges) {
+        gc_node *c = e->n;
+        if(c == nullptr)
+          continue;
+        ++c->rc;
+        if(c->color != gc_color::black) {
+          c->color = gc_color::black;
+          stack.push_back(c);
+        }
+      }
+    }
+  }
+
+  std::size_t collect_roots() {
+    std::vector<gc_node*> white;
+    for(gc_node *s : roots) {
+      s->buffered = false;
+      collect_white(s, white);
+    }
+    roots.clear();
+
+    /**
+     * 白色节点之间的边在试删除时已经扣掉了，白色指向黑色的边也已经扣掉了
+     * 所以析构对象之前先把所有出边置空，避免成员 tracked_ptr 析构时再次递减
+     */
+    for(gc_node *n : white) {
+      for(tracked_ptr_base *e : n->edges)
+        e->n = nullptr;
+      n->edges.clear();
+    }
+    for(gc_node *n : white) {
+      auto &site = leaks[demangle(n->type) + " @ " + n->file + ":" + std::to_string(n->line)];
+      ++site.objects;
+      site.bytes += n->object_size;
+      n->destroy(n);
+    }
+    for(gc_node *n : white)
+      n->free(n);
+    return white.size();
+  }
+
+  void collect_white(gc_node *s, std::vector<gc_node*> &white) {
+    std::vector<gc_node*> stack{s};
+    while(!stack.empty()) {
+      gc_node *n = stack.back();
+      stack.pop_back();
+      if(n->color != gc_color::white || n->buffered)
+        continue;
+      n->color = gc_color::black;
+      white.push_back(n);
+      for(tracked_ptr_base *e : n->edges)
+        if(e->n != nullptr)
+          stack.push_back(e->n);
+    }
+  }
+
+  /* typeid(T).name() 是修饰过的名字（"1A"），报告里换成源码中的写法；同一个类型只解一次 */
+  const std::string& demangle(const char *mangled) {
+    auto it = demangled.find(mangled);
+    if(it != demangled.end())
+      return it->second;
+    int status = 0;
+    char *name = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+    std::string readable = status == 0 ? name : mangled;
+    std::free(name);
+    return demangled.emplace(mangled, std::move(readable)).first->second;
+  }
+
+  std::vector<gc_node*> roots;
+  std::map<std::string, site_stats> leaks;
+  std::map<const char*, std::string> demangled;
+};
+
+void tracked_ptr_base::register_edge() {
+  auto &building = gc_heap::instance().constructing;
+  if(building.empty())
+    return;
+  gc_node *owner = building.back();
+  auto *self = reinterpret_cast<char*>(this);
+  auto *begin = static_cast<char*>(owner->object);
+  if(self >= begin && self < begin + owner->object_size)
+    owner->edges.push_back(this);
+}
+
+template<typename T>
+class tracked_ptr : public tracked_ptr_base {
+public:
+  tracked_ptr() = default;
+  tracked_ptr(std::nullptr_t) {}
+
+  tracked_ptr(const tracked_ptr &other) : tracked_ptr_base(other.n) {
+    if(n)
+      gc_heap::instance().increment(n);
+  }
+
+  /* 移动时引用计数不变，但边的登记是按地址来的，因此仍然走一次登记 */
+  tracked_ptr(tracked_ptr &&other) noexcept : tracked_ptr_base(other.n) {
+    other.n = nullptr;
+  }
+
+  /* 自赋值时 reset() 会把 other.n 一起清空，所以先取出来 */
+  tracked_ptr& operator=(const tracked_ptr &other) {
+    gc_node *o = other.n;
+    if(o)
+      gc_heap::instance().increment(o);
+    reset();
+    n = o;
+    return *this;
+  }
+
+  tracked_ptr& operator=(tracked_ptr &&other) noexcept {
+    if(this != &other) {
+      reset();
+      n = other.n;
+      other.n = nullptr;
+    }
+    return *this;
+  }
+
+  ~tracked_ptr() { reset(); }
+
+  void reset() {
+    if(gc_node *old = std::exchange(n, nullptr))
+      gc_heap::instance().decrement(old);
+  }
+
+  T* get() const { return n ? static_cast<T*>(n->object) : nullptr; }
+  T& operator*() const { return *get(); }
+  T* operator->() const { return get(); }
+  explicit operator bool() const { return n != nullptr; }
+  std::size_t use_count() const { return n ? n->rc : 0; }
+
+private:
+  explicit tracked_ptr(gc_node *adopt) : tracked_ptr_base(adopt) {}
+
+  template<typename U, typename... Args>
+  friend tracked_ptr<U> make_tracked_at(const char*, int, Args&&...);
+};
+
+/* 节点头和对象放在一次分配中，类似 make_shared 的控制块 */
+template<typename T>
+struct gc_box : gc_node {
+  alignas(T) unsigned char storage[sizeof(T)];
+};
+
+template<typename T, typename... Args>
+tracked_ptr<T> make_tracked_at(const char *file, int line, Args&&... args) {
+  auto *box = new gc_box<T>;
+  box->file = file;
+  box->line = line;
+  box->type = typeid(T).name();
+  box->object = box->storage;
+  box->object_size = sizeof(T);
+  box->destroy = [](gc_node *n) { static_cast<T*>(n->object)->~T(); };
+  box->free = [](gc_node *n) { delete static_cast<gc_box<T>*>(n); };
+
+  auto &building = gc_heap::instance().constructing;
+  building.push_back(box);
+  try {
+    new (box->storage) T(std::forward<Args>(args)...);
+  } catch(...) {
+    building.pop_back();
+    delete box;
+    throw;
+  }
+  building.pop_back();
+  return tracked_ptr<T>(static_cast<gc_node*>(box));
+}
+
+/* 记录调用处的文件和行号，作为泄漏报告里的分配位置 */
+#define make_tracked(T, ...) make_tracked_at<T>(__FILE__, __LINE__, ##__VA_ARGS__)
+
+#endif
@@ -0,0 +1,133 @@
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "fast_pimpl.h"
+
+/**
+ * @brief fast_pimpl.h 的使用：同一个 Widget 分别用 fast_pimpl 和 unique_ptr 实现，对比构造、访问和析构
+ */
+
+/**
+ * ------------------------------ widget.h ------------------------------
+ * 客户只看到 Impl 的声明，以及实现所需的尺寸和对齐
+ */
+class Widget {
+public:
+  Widget();
+  explicit Widget(int value);
+  Widget(const Widget &other);
+  Widget(Widget &&other) noexcept;
+  Widget& operator=(const Widget &other);
+  Widget& operator=(Widget &&other) noexcept;
+  ~Widget();
+
+  int value() const;
+  void add(int v);
+
+private:
+  struct Impl;
+  fast_pimpl<Impl, 48, 8> pImpl;
+};
+
+/* 作为对照的 unique_ptr 版本，与 docs/Pimpl.md 中的写法一致 */
+class HeapWidget {
+public:
+  HeapWidget();
+  explicit HeapWidget(int value);
+  HeapWidget(const HeapWidget &other);
+  HeapWidget(HeapWidget &&other) noexcept;
+  HeapWidget& operator=(const HeapWidget &other);
+  HeapWidget& operator=(HeapWidget &&other) noexcept;
+  ~HeapWidget();
+
+  int value() const;
+  void add(int v);
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> pImpl;
+};
+
+/**
+ * ------------------------------ widget.cc ------------------------------
+ * Impl 在这里才是完整型别，fast_pimpl 的成员函数在这里实例化，static_assert 也在这里触发
+ */
+struct Widget::Impl {
+  std::string name = "widget";
+  int value = 0;
+};
+
+Widget::Widget() = default;
+Widget::Widget(int value) : pImpl() { pImpl->value = value; }
+Widget::Widget(const Widget &other) = default;
+Widget::Widget(Widget &&other) noexcept = default;
+Widget& Widget::operator=(const Widget &other) = default;
+Widget& Widget::operator=(Widget &&other) noexcept = default;
+Widget::~Widget() = default;
+
+int Widget::value() const { return pImpl->value; }
+void Widget::add(int v) { pImpl->value += v; }
+
+struct HeapWidget::Impl {
+  std::string name = "widget";
+  int value = 0;
+};
+
+HeapWidget::HeapWidget() : pImpl(std::make_unique<Impl>()) {}
+HeapWidget::HeapWidget(int value) : pImpl(std::make_unique<Impl>()) { pImpl->value = value; }
+HeapWidget::HeapWidget(const HeapWidget &other) : pImpl(std::make_unique<Impl>(*other.pImpl)) {}
+HeapWidget::HeapWidget(HeapWidget &&other) noexcept = default;
+HeapWidget& HeapWidget::operator=(const HeapWidget &other) {
+  *pImpl = *other.pImpl;
+  return *this;
+}
+HeapWidget& HeapWidget::operator=(HeapWidget &&other) noexcept = default;
+HeapWidget::~HeapWidget() = default;
+
+int HeapWidget::value() const { return pImpl->value; }
+void HeapWidget::add(int v) { pImpl->value += v; }
+
+/**
+ * ------------------------------ main.cc ------------------------------
+ * 构造 kCount 个对象，再对每个对象做一次成员访问
+ */
+template<typename W>
+void bench(const char *name) {
+  constexpr int kCount = 4000000;
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<W> v;
+  v.reserve(kCount);
+  for(int i = 0; i < kCount; ++i)
+    v.emplace_back(i);
+  auto t1 = std::chrono::steady_clock::now();
+  for(auto &w : v)
+    w.add(1);
+  long long sum = 0;
+  for(auto &w : v)
+    sum += w.value();
+  auto t2 = std::chrono::steady_clock::now();
+  v.clear();
+  auto t3 = std::chrono::steady_clock::now();
+
+  using ms = std::chrono::duration<double, std::milli>;
+  std::cout << name << ": sizeof = " << sizeof(W)
+            << ", construct " << ms(t1 - t0).count() << " ms"
+            << ", access " << ms(t2 - t1).count() << " ms"
+            << ", destroy " << ms(t3 - t2).count() << " ms"
+            << ", sum = " << sum << "\n";
+}
+
+int main() {
+  Widget w1(1);
+  Widget w2 = w1;       // 拷贝
+  Widget w3 = std::move(w2);  // 移动
+  w3.add(10);
+  w1 = w3;              // 拷贝赋值
+  std::cout << "w1.value() = " << w1.value() << ", w3.value() = " << w3.value() << "\n";
+
+  bench<HeapWidget>("unique_ptr pimpl");
+  bench<Widget>("fast_pimpl      ");
+}
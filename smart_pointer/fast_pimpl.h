@@ -0,0 +1,81 @@
+#ifndef FAST_PIMPL_H
+#define FAST_PIMPL_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Fast Pimpl：把实现放在对象内部的对齐存储里
+ * docs/Pimpl.md 中的 unique_ptr 版本每个对象要一次堆分配，每次访问成员还要多一次间接寻址
+ *
+ * fast_pimpl<Impl, Size, Align> 在头文件中只需要知道 Impl 的尺寸和对齐的上限，不需要 Impl 的定义
+ * 1. 所有会用到 Impl 完整定义的成员函数都是模版，只有在实现文件中被调用时才会实例化
+ * 2. 因此和 unique_ptr 版本一样，外层类必须在头文件中声明特种成员函数，在实现文件中 = default
+ * 3. 实例化时用 static_assert 检查 Size 和 Align 是否足够，Impl 改变之后头文件没有同步修改会直接编译失败
+ *
+ * 代价是 Impl 的尺寸泄漏到了头文件，Impl 变大之后客户代码需要重新编译
+ */
+template<typename Impl, std::size_t Size, std::size_t Align = alignof(std::max_align_t)>
+class fast_pimpl {
+public:
+  fast_pimpl() {
+    validate();
+    new (&storage) Impl();
+  }
+
+  /* 排除参数本身就是 fast_pimpl 的情况，否则非 const 左值的拷贝会匹配到这里 */
+  template<typename Arg, typename... Args,
+           typename = std::enable_if_t<!std::is_same<std::decay_t<Arg>, fast_pimpl>::value>>
+  explicit fast_pimpl(Arg &&arg, Args&&... args) {
+    validate();
+    new (&storage) Impl(std::forward<Arg>(arg), std::forward<Args>(args)...);
+  }
+
+  fast_pimpl(const fast_pimpl &other) {
+    validate();
+    new (&storage) Impl(*other);
+  }
+
+  fast_pimpl(fast_pimpl &&other) noexcept(std::is_nothrow_move_constructible<Impl>::value) {
+    validate();
+    new (&storage) Impl(std::move(*other));
+  }
+
+  fast_pimpl& operator=(const fast_pimpl &other) {
+    **this = *other;
+    return *this;
+  }
+
+  fast_pimpl& operator=(fast_pimpl &&other) noexcept(std::is_nothrow_move_assignable<Impl>::value) {
+    **this = std::move(*other);
+    return *this;
+  }
+
+  ~fast_pimpl() {
+    validate();
+    get()->~Impl();
+  }
+
+  Impl* get() noexcept { return std::launder(reinterpret_cast<Impl*>(&storage)); }
+  const Impl* get() const noexcept { return std::launder(reinterpret_cast<const Impl*>(&storage)); }
+  Impl& operator*() noexcept { return *get(); }
+  const Impl& operator*() const noexcept { return *get(); }
+  Impl* operator->() noexcept { return get(); }
+  const Impl* operator->() const noexcept { return get(); }
+
+private:
+  /* 模版参数放进 static_assert 的条件里，报错信息中可以直接看到实际需要的尺寸 */
+  template<std::size_t ActualSize, std::size_t ActualAlign>
+  static void check() noexcept {
+    static_assert(Size >= ActualSize, "fast_pimpl: Size is too small, enlarge it in the header");
+    static_assert(Align % ActualAlign == 0, "fast_pimpl: Align is not a multiple of alignof(Impl)");
+  }
+
+  static void validate() noexcept { check<sizeof(Impl), alignof(Impl)>(); }
+
+  std::aligned_storage_t<Size, Align> storage;
+};
+
+#endif
@@ -0,0 +1,147 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "pool_allocator.h"
+
+/**
+ * @brief pool_allocator.h 的使用，以及多线程 churn 负载下和 glibc malloc 的吞吐、碎片对比
+ */
+
+struct Foo {
+  int a;
+  double b;
+  Foo(int a, double b) : a(a), b(b) { std::cout << "Foo:Foo\n"; }
+  ~Foo() { std::cout << "Foo:~Foo\n"; }
+};
+
+/**
+ * @brief 多线程 churn 负载
+ * 每个线程维护 kLive 个槽位，随机选择一个槽位释放并重新分配一个随机大小（16~256）的块，
+ * 以此模拟长期运行服务中大量小对象的反复创建和销毁
+ *
+ * live 由调用者预先分配好（每个线程 kLive 个槽位），结束时仍然存活的块留在其中，供调用者统计碎片
+ */
+using Slots = std::vector<std::pair<void*, std::size_t>>;
+
+constexpr int kLive = 4096;
+
+template<typename Alloc, typename Free>
+double churn(int threads, int ops, Alloc alloc, Free dealloc, std::vector<Slots> &live) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> vt;
+  for(int t = 0; t < threads; ++t) {
+    vt.emplace_back([&, t] {
+      std::mt19937 rng(t);
+      Slots &slots = live[t];
+      for(int i = 0; i < ops; ++i) {
+        auto &s = slots[rng() % kLive];
+        if(s.first)
+          dealloc(s.first, s.second);
+        s.second = 16 + rng() % 241;
+        s.first = alloc(s.second);
+        *static_cast<char*>(s.first) = 1;
+      }
+    });
+  }
+  for(auto &t : vt)
+    t.join();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double>(end - start).count();
+}
+
+std::size_t live_bytes(const std::vector<Slots> &live) {
+  std::size_t bytes = 0;
+  for(auto &slots : live)
+    for(auto &s : slots)
+      bytes += s.second;
+  return bytes;
+}
+
+/* 当前进程的常驻内存（RSS），包括所有 malloc arena，而不只是主 arena */
+std::size_t rss_bytes() {
+  long pages = 0, resident = 0;
+  if(std::FILE *f = std::fopen("/proc/self/statm", "r")) {
+    if(std::fscanf(f, "%ld %ld", &pages, &resident) != 2)
+      resident = 0;
+    std::fclose(f);
+  }
+  return static_cast<std::size_t>(resident) * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+/* 在子进程中运行：glibc free 之后不一定把内存还给系统，分开运行两个分配器的 RSS 才互不影响 */
+template<typename F>
+void run_isolated(F f) {
+  std::cout.flush();
+  pid_t pid = fork();
+  if(pid == 0) {
+    f();
+    std::cout.flush();
+    _exit(0);
+  }
+  waitpid(pid, nullptr, 0);
+}
+
+int main() {
+  /* allocate_shared：控制块和对象一次分配，且来自 slab */
+  {
+    auto sp = std::allocate_shared<Foo>(PoolAllocator<Foo>(), 1, 2.0);
+    auto sp2 = sp;  // 引用计数 +1
+    std::cout << "sp.use_count() = " << sp.use_count() << ", a = " << sp->a << "\n";
+  }
+
+  /* pool_make_unique：配套的删除器会将内存归还到对应的 size class */
+  {
+    auto up = pool_make_unique<Foo>(3, 4.0);
+    std::cout << "up->a = " << up->a << ", sizeof(up) = " << sizeof(up) << "\n";
+  }
+
+  /* pmr 容器 */
+  {
+    SlabResource res;
+    std::pmr::vector<int> v(&res);
+    for(int i = 0; i < 10; ++i)
+      v.push_back(i);
+    std::cout << "pmr vector size = " << v.size() << "\n\n";
+  }
+
+  constexpr int kThreads = 4;
+  constexpr int kOps = 2000000;
+  const double total_ops = double(kThreads) * kOps;
+
+  /**
+   * 碎片按 RSS 的增长计算：churn 线程从各自的 arena 分配，mallinfo2 只统计主 arena，会低估 malloc 的开销
+   * 槽位数组在取基准之前分配好，不计入增长
+   */
+  /* glibc malloc */
+  run_isolated([&] {
+    std::vector<Slots> live(kThreads, Slots(kLive, {nullptr, 0}));
+    std::size_t rss0 = rss_bytes();
+    double t = churn(kThreads, kOps,
+        [](std::size_t n) { return std::malloc(n); },
+        [](void *p, std::size_t) { std::free(p); }, live);
+    std::size_t grown = rss_bytes() - rss0, bytes = live_bytes(live);
+    std::cout << "malloc: " << total_ops / t / 1e6 << " Mops/s, "
+              << "RSS grown " << grown << " B, live " << bytes << " B, "
+              << "overhead " << double(grown) / bytes << "x\n";
+  });
+
+  /* slab 分配器 */
+  run_isolated([&] {
+    std::vector<Slots> live(kThreads, Slots(kLive, {nullptr, 0}));
+    std::size_t rss0 = rss_bytes();
+    double t = churn(kThreads, kOps,
+        [](std::size_t n) { return SlabPool::instance().allocate(n); },
+        [](void *p, std::size_t n) { SlabPool::instance().deallocate(p, n); }, live);
+    std::size_t grown = rss_bytes() - rss0, bytes = live_bytes(live);
+    std::cout << "slab:   " << total_ops / t / 1e6 << " Mops/s, "
+              << "RSS grown " << grown << " B (slab reserved " << SlabPool::instance().reserved_bytes()
+              << " B), live " << bytes << " B, overhead " << double(grown) / bytes << "x\n";
+  });
+}
@@ -0,0 +1,214 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+
+/**
+ * @brief 小对象的分级 slab 分配器
+ * make_shared / make_unique 默认都走全局堆 ::operator new，对于大量的小对象，
+ * malloc 的加锁、元数据维护以及碎片都会成为瓶颈
+ *
+ * 这里的做法：
+ * 1. 按 16 字节为粒度划分 size class（16, 32, ..., 256），超过 256 字节的直接走 ::operator new
+ * 2. 每个 size class 有一个全局的 depot（中心空闲链表，mutex 保护），空了就从 64KB 的 slab 中切块
+ * 3. 每个线程每个 size class 有一个 magazine（thread_local 的指针数组），
+ *    分配和释放绝大多数情况下只操作 magazine，不加锁也没有原子操作
+ * 4. magazine 空了就从 depot 批量取一半，满了就批量还一半，线程退出时全部还给 depot
+ *
+ * 对外暴露三种接口：
+ * 1. PoolAllocator<T>，可以配合 std::allocate_shared 使用（控制块和对象一起从池中分配）
+ * 2. pool_make_unique<T>，返回 std::unique_ptr<T, PoolDeleter<T>>
+ * 3. SlabResource，一个 std::pmr::memory_resource，可以给 pmr 容器使用
+ */
+
+class SlabPool {
+public:
+  static constexpr std::size_t kGranularity = 16;
+  static constexpr std::size_t kMaxSize = 256;
+  static constexpr std::size_t kNumClasses = kMaxSize / kGranularity;
+  static constexpr std::size_t kSlabSize = 64 * 1024;
+  static constexpr std::size_t kMagazineSize = 64;
+
+  /* depot 永远不析构，避免线程退出时 magazine 归还到一个已经被销毁的对象上 */
+  static SlabPool& instance() {
+    static SlabPool *pool = new SlabPool;
+    return *pool;
+  }
+
+  static std::size_t size_class(std::size_t n) {
+    return (n + kGranularity - 1) / kGranularity - 1;
+  }
+
+  void* allocate(std::size_t n) {
+    if(n == 0)
+      n = 1;
+    if(n > kMaxSize)
+      return ::operator new(n);
+    Magazine &m = local().mags[size_class(n)];
+    if(m.count == 0)
+      refill(size_class(n), m);
+    return m.slots[--m.count];
+  }
+
+  void deallocate(void *p, std::size_t n) noexcept {
+    if(p == nullptr)
+      return;
+    if(n == 0)
+      n = 1;
+    if(n > kMaxSize) {
+      ::operator delete(p);
+      return;
+    }
+    Magazine &m = local().mags[size_class(n)];
+    if(m.count == kMagazineSize)
+      flush(size_class(n), m, kMagazineSize / 2);
+    m.slots[m.count++] = p;
+  }
+
+  /* 从操作系统拿到的 slab 总字节数 */
+  std::size_t reserved_bytes() const {
+    return reserved.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct FreeNode {
+    FreeNode *next;
+  };
+
+  struct Depot {
+    std::mutex mtx;
+    FreeNode *head = nullptr;
+  };
+
+  struct Magazine {
+    std::size_t count = 0;
+    void *slots[kMagazineSize];
+  };
+
+  struct LocalCache {
+    Magazine mags[kNumClasses];
+    ~LocalCache() {
+      for(std::size_t c = 0; c < kNumClasses; ++c)
+        SlabPool::instance().flush(c, mags[c], mags[c].count);
+    }
+  };
+
+  static LocalCache& local() {
+    thread_local LocalCache cache;
+    return cache;
+  }
+
+  void refill(std::size_t c, Magazine &m) {
+    Depot &d = depots[c];
+    std::lock_guard<std::mutex> lock(d.mtx);
+    if(d.head == nullptr)
+      carve(c, d);
+    while(d.head != nullptr && m.count < kMagazineSize / 2) {
+      m.slots[m.count++] = d.head;
+      d.head = d.head->next;
+    }
+  }
+
+  void flush(std::size_t c, Magazine &m, std::size_t n) noexcept {
+    Depot &d = depots[c];
+    std::lock_guard<std::mutex> lock(d.mtx);
+    while(n-- > 0) {
+      auto *node = static_cast<FreeNode*>(m.slots[--m.count]);
+      node->next = d.head;
+      d.head = node;
+    }
+  }
+
+  /* 将一个新的 slab 按块大小切分后挂到 depot 上，调用者持有 depot 的锁 */
+  void carve(std::size_t c, Depot &d) {
+    std::size_t block = (c + 1) * kGranularity;
+    char *slab = static_cast<char*>(::operator new(kSlabSize));
+    reserved.fetch_add(kSlabSize, std::memory_order_relaxed);
+    for(std::size_t off = 0; off + block <= kSlabSize; off += block) {
+      auto *node = reinterpret_cast<FreeNode*>(slab + off);
+      node->next = d.head;
+      d.head = node;
+    }
+  }
+
+  Depot depots[kNumClasses];
+  std::atomic<std::size_t> reserved{0};
+};
+
+/* 供 std::allocate_shared 以及标准容器使用的分配器 */
+template<typename T>
+struct PoolAllocator {
+  using value_type = T;
+
+  PoolAllocator() noexcept = default;
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    static_assert(alignof(T) <= SlabPool::kGranularity, "over-aligned type is not supported by SlabPool");
+    if(n > std::numeric_limits<std::size_t>::max() / sizeof(T))
+      throw std::bad_array_new_length();
+    return static_cast<T*>(SlabPool::instance().allocate(n * sizeof(T)));
+  }
+  void deallocate(T *p, std::size_t n) noexcept {
+    SlabPool::instance().deallocate(p, n * sizeof(T));
+  }
+
+  template<typename U>
+  bool operator==(const PoolAllocator<U>&) const noexcept { return true; }
+  template<typename U>
+  bool operator!=(const PoolAllocator<U>&) const noexcept { return false; }
+};
+
+/* pool_make_unique 对应的删除器，释放时需要知道对象大小以找到 size class */
+template<typename T>
+struct PoolDeleter {
+  void operator()(T *p) const noexcept {
+    p->~T();
+    SlabPool::instance().deallocate(p, sizeof(T));
+  }
+};
+
+template<typename T>
+using pool_unique_ptr = std::unique_ptr<T, PoolDeleter<T>>;
+
+template<typename T, typename... Args>
+pool_unique_ptr<T> pool_make_unique(Args&&... args) {
+  static_assert(alignof(T) <= SlabPool::kGranularity, "over-aligned type is not supported by SlabPool");
+  void *mem = SlabPool::instance().allocate(sizeof(T));
+  try {
+    return pool_unique_ptr<T>(new (mem) T(std::forward<Args>(args)...));
+  } catch(...) {
+    SlabPool::instance().deallocate(mem, sizeof(T));
+    throw;
+  }
+}
+
+/**
+ * @brief pmr 版本
+ * slab 中的块按 16 字节对齐，对齐要求更高的请求交给 upstream
+ */
+class SlabResource : public std::pmr::memory_resource {
+private:
+  void* do_allocate(std::size_t bytes, std::size_t align) override {
+    if(align > SlabPool::kGranularity)
+      return ::operator new(bytes, std::align_val_t(align));
+    return SlabPool::instance().allocate(bytes);
+  }
+  void do_deallocate(void *p, std::size_t bytes, std::size_t align) override {
+    if(align > SlabPool::kGranularity)
+      return ::operator delete(p, std::align_val_t(align));
+    SlabPool::instance().deallocate(p, bytes);
+  }
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return dynamic_cast<const SlabResource*>(&other) != nullptr;
+  }
+};
+
+#endif
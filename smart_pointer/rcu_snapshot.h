@@ -0,0 +1,178 @@
+#ifndef RCU_SNAPSHOT_H
+#define RCU_SNAPSHOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 读多写少的配置对象发布
+ * 常见的写法是用 shared_ptr 发布配置，每个请求拷贝一份：
+ * 1. std::atomic_load(&sp) / std::atomic<std::shared_ptr>，libstdc++ 内部用的是一个按地址散列的互斥锁池
+ * 2. 即使是无锁实现，拷贝也要对控制块做一次原子加减，所有读线程都在争抢同一个 cache line
+ *
+ * 这里用 epoch 延迟回收（类似用户态 RCU）实现 rcu_snapshot<T>：
+ * 1. 每个读线程在全局的 rcu_domain 中占一个独占 cache line 的槽位
+ * 2. 读：把当前全局 epoch 写到自己的槽位（普通 store，不是 RMW），一次 fence，然后 load 指针
+ *    读结束把槽位清零。整个过程只写自己的 cache line，没有任何共享的原子 RMW
+ * 3. 写：exchange 新指针，全局 epoch 加一，旧指针连同退休时的 epoch 放入退休链表
+ *    所有活跃槽位的 epoch 都大于退休 epoch 之后，说明没有读者还能看到旧对象，可以 delete
+ *
+ * 读者在 guard 存活期间不能长时间阻塞，否则写者的旧对象无法回收
+ */
+class rcu_domain {
+public:
+  static constexpr int kMaxReaders = 128;
+
+  static rcu_domain& instance() {
+    static rcu_domain domain;
+    return domain;
+  }
+
+  /* 进入读临界区，支持同一线程嵌套 */
+  void read_lock() {
+    reader &r = local();
+    if(r.depth++ > 0)
+      return;
+    /* acquire 与写者 advance() 中的 fetch_add 配对：读到新 epoch 的读者也能看到推进前 exchange 进去的新指针 */
+    r.slot->epoch.store(epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+    /* 保证槽位的写入先于随后对指针的 load 对写者可见 */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  void read_unlock() {
+    reader &r = local();
+    if(--r.depth == 0)
+      r.slot->epoch.store(0, std::memory_order_release);
+  }
+
+  /* 返回本次退休的 epoch，epoch 从 1 开始，0 表示槽位处于静止状态 */
+  std::uint64_t advance() {
+    std::uint64_t retired = epoch.fetch_add(1, std::memory_order_acq_rel);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return retired;
+  }
+
+  /* 所有正在读的线程进入读临界区时看到的最小 epoch */
+  std::uint64_t min_active() const {
+    std::uint64_t min = UINT64_MAX;
+    for(auto &s : slots) {
+      std::uint64_t e = s.epoch.load(std::memory_order_acquire);
+      if(e != 0 && e < min)
+        min = e;
+    }
+    return min;
+  }
+
+private:
+  struct alignas(64) slot_t {
+    std::atomic<std::uint64_t> epoch{0};
+    std::atomic<bool> used{false};
+  };
+
+  struct reader {
+    slot_t *slot = nullptr;
+    int depth = 0;
+    ~reader() {
+      if(slot)
+        slot->used.store(false, std::memory_order_release);
+    }
+  };
+
+  /* 每个线程第一次读的时候占用一个空闲槽位，线程退出时归还 */
+  reader& local() {
+    thread_local reader r;
+    if(r.slot == nullptr) {
+      for(auto &s : slots) {
+        bool expected = false;
+        if(!s.used.load(std::memory_order_relaxed) && s.used.compare_exchange_strong(expected, true)) {
+          r.slot = &s;
+          break;
+        }
+      }
+      if(r.slot == nullptr)
+        throw std::runtime_error("rcu_domain: too many reader threads");
+    }
+    return r;
+  }
+
+  std::atomic<std::uint64_t> epoch{1};
+  slot_t slots[kMaxReaders];
+};
+
+template<typename T>
+class rcu_snapshot {
+public:
+  /* 读临界区的 RAII 对象，存活期间指针有效 */
+  class guard {
+  public:
+    explicit guard(const rcu_snapshot &s) {
+      rcu_domain::instance().read_lock();
+      p = s.current.load(std::memory_order_acquire);
+    }
+    ~guard() { rcu_domain::instance().read_unlock(); }
+    guard(const guard&) = delete;
+    guard& operator=(const guard&) = delete;
+
+    const T* get() const { return p; }
+    const T& operator*() const { return *p; }
+    const T* operator->() const { return p; }
+
+  private:
+    const T *p;
+  };
+
+  explicit rcu_snapshot(std::unique_ptr<T> init) : current(init.release()) {}
+
+  ~rcu_snapshot() {
+    delete current.load();
+    for(auto &r : retired)
+      delete r.second;
+  }
+
+  rcu_snapshot(const rcu_snapshot&) = delete;
+  rcu_snapshot& operator=(const rcu_snapshot&) = delete;
+
+  guard read() const { return guard(*this); }
+
+  /* 发布新的配置，旧的配置延迟回收。多个写者之间用 mtx 串行化 */
+  void store(std::unique_ptr<T> next) {
+    std::lock_guard<std::mutex> lock(mtx);
+    T *old = current.exchange(next.release(), std::memory_order_acq_rel);
+    retired.emplace_back(rcu_domain::instance().advance(), old);
+    reclaim();
+  }
+
+  /* 阻塞直到所有已退休的对象都被回收 */
+  void synchronize() {
+    std::lock_guard<std::mutex> lock(mtx);
+    while(!retired.empty()) {
+      reclaim();
+      std::this_thread::yield();
+    }
+  }
+
+private:
+  void reclaim() {
+    std::uint64_t min = rcu_domain::instance().min_active();
+    std::size_t kept = 0;
+    for(auto &r : retired) {
+      if(r.first < min)
+        delete r.second;
+      else
+        retired[kept++] = r;
+    }
+    retired.resize(kept);
+  }
+
+  std::atomic<T*> current;
+  std::mutex mtx;
+  std::vector<std::pair<std::uint64_t, T*>> retired;
+};
+
+#endif
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+#include "slot_map.h"
+
+/**
+ * @brief slot_map.h 的使用，以及和 shared_ptr + weak_ptr 句柄在插入、删除、查找、遍历上的对比
+ */
+
+struct Entity {
+  float x, y, z;
+  int hp;
+};
+
+using ms = std::chrono::duration<double, std::milli>;
+
+int main(int argc, char **argv) {
+  slot_map<Entity> demo;
+  auto h1 = demo.emplace(Entity{1, 2, 3, 100});
+  auto h2 = demo.emplace(Entity{4, 5, 6, 50});
+  demo.erase(h1);
+  auto h3 = demo.emplace(Entity{7, 8, 9, 10});  // 复用 h1 的槽位，generation 不同
+  std::cout << std::boolalpha << "h1 valid: " << demo.valid(h1)
+            << ", h2 hp: " << demo.get(h2)->hp
+            << ", h3 index == h1 index: " << (h3.index == h1.index) << "\n\n";
+
+  /* 默认 1000 万个实体，可以通过命令行参数修改 */
+  const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  std::mt19937 rng(42);
+  std::vector<std::uint32_t> order(n);
+  for(std::size_t i = 0; i < n; ++i)
+    order[i] = static_cast<std::uint32_t>(i);
+  std::shuffle(order.begin(), order.end(), rng);
+
+  /* shared_ptr 持有对象，weak_ptr 作为句柄 */
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<Entity>> owners;
+    std::vector<std::weak_ptr<Entity>> handles;
+    owners.reserve(n);
+    handles.reserve(n);
+    for(std::size_t i = 0; i < n; ++i) {
+      owners.push_back(std::make_shared<Entity>(Entity{1, 2, 3, int(i)}));
+      handles.push_back(owners.back());
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < n; i += 2)
+      owners[i].reset();  // 删除一半
+    auto t2 = std::chrono::steady_clock::now();
+    long long sum = 0;
+    for(auto i : order)
+      if(auto sp = handles[i].lock())
+        sum += sp->hp;
+    auto t3 = std::chrono::steady_clock::now();
+    long long iter = 0;
+    for(auto &sp : owners)
+      if(sp)
+        iter += sp->hp;
+    auto t4 = std::chrono::steady_clock::now();
+    std::cout << "shared_ptr/weak_ptr: insert " << ms(t1 - t0).count() << " ms"
+              << ", erase " << ms(t2 - t1).count() << " ms"
+              << ", lookup " << ms(t3 - t2).count() << " ms"
+              << ", iterate " << ms(t4 - t3).count() << " ms"
+              << " (" << sum << ", " << iter << ")\n";
+  }
+
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    slot_map<Entity> entities;
+    std::vector<slot_handle> handles;
+    entities.reserve(n);
+    handles.reserve(n);
+    for(std::size_t i = 0; i < n; ++i)
+      handles.push_back(entities.emplace(Entity{1, 2, 3, int(i)}));
+    auto t1 = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < n; i += 2)
+      entities.erase(handles[i]);
+    auto t2 = std::chrono::steady_clock::now();
+    long long sum = 0;
+    for(auto i : order)
+      if(Entity *e = entities.get(handles[i]))
+        sum += e->hp;
+    auto t3 = std::chrono::steady_clock::now();
+    long long iter = 0;
+    for(auto &e : entities)
+      iter += e.hp;
+    auto t4 = std::chrono::steady_clock::now();
+    std::cout << "slot_map:            insert " << ms(t1 - t0).count() << " ms"
+              << ", erase " << ms(t2 - t1).count() << " ms"
+              << ", lookup " << ms(t3 - t2).count() << " ms"
+              << ", iterate " << ms(t4 - t3).count() << " ms"
+              << " (" << sum << ", " << iter << ")\n";
+  }
+}
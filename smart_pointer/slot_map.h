@@ -0,0 +1,101 @@
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief 用 slot map 代替 weak_ptr 作为"对象是否还存在"的句柄
+ * weak_ptr::lock() 每次都要对控制块做一次 CAS 循环，还要先解引用控制块，
+ * 并且每个对象各自一次堆分配，遍历所有存活对象时在内存中到处跳
+ *
+ * slot_map<T> 的结构：
+ * 1. values：所有存活对象紧密排列的数组，遍历就是顺序扫描
+ * 2. slots：句柄索引到 values 下标的间接表，每个槽位带一个 generation
+ * 3. owners：values 下标反查槽位，删除时把最后一个元素搬到空洞中，需要修正它的槽位
+ *
+ * 句柄是 32 位索引 + 32 位 generation，槽位被删除时 generation 加一，
+ * 旧的句柄再来访问时 generation 对不上，就能检测出对象已经不存在了，整个过程没有引用计数
+ * 空闲的槽位串成一个空闲链表，插入、删除、查找都是 O(1)
+ */
+struct slot_handle {
+  std::uint32_t index;
+  std::uint32_t generation;
+};
+
+template<typename T>
+class slot_map {
+public:
+  template<typename... Args>
+  slot_handle emplace(Args&&... args) {
+    std::uint32_t idx;
+    if(free_head != kNone) {
+      idx = free_head;
+      free_head = slots[idx].pos;
+    } else {
+      idx = static_cast<std::uint32_t>(slots.size());
+      slots.push_back({0, 0});
+    }
+    slots[idx].pos = static_cast<std::uint32_t>(values.size());
+    values.emplace_back(std::forward<Args>(args)...);
+    owners.push_back(idx);
+    return {idx, slots[idx].generation};
+  }
+
+  /* 句柄已经失效时返回 false */
+  bool erase(slot_handle h) {
+    if(!valid(h))
+      return false;
+    std::uint32_t pos = slots[h.index].pos;
+    std::uint32_t last = static_cast<std::uint32_t>(values.size() - 1);
+    if(pos != last) {
+      values[pos] = std::move(values[last]);
+      owners[pos] = owners[last];
+      slots[owners[pos]].pos = pos;
+    }
+    values.pop_back();
+    owners.pop_back();
+
+    ++slots[h.index].generation;
+    slots[h.index].pos = free_head;
+    free_head = h.index;
+    return true;
+  }
+
+  bool valid(slot_handle h) const {
+    return h.index < slots.size() && slots[h.index].generation == h.generation;
+  }
+
+  /* 相当于 weak_ptr::lock()，失效时返回 nullptr */
+  T* get(slot_handle h) {
+    return valid(h) ? &values[slots[h.index].pos] : nullptr;
+  }
+
+  std::size_t size() const { return values.size(); }
+  void reserve(std::size_t n) {
+    values.reserve(n);
+    owners.reserve(n);
+    slots.reserve(n);
+  }
+
+  /* 直接遍历紧密数组 */
+  typename std::vector<T>::iterator begin() { return values.begin(); }
+  typename std::vector<T>::iterator end() { return values.end(); }
+
+private:
+  static constexpr std::uint32_t kNone = UINT32_MAX;
+
+  struct slot {
+    std::uint32_t pos;         // 存活时为 values 下标，空闲时为下一个空闲槽位
+    std::uint32_t generation;
+  };
+
+  std::vector<T> values;
+  std::vector<std::uint32_t> owners;
+  std::vector<slot> slots;
+  std::uint32_t free_head = kNone;
+};
+
+#endif
@@ -0,0 +1,297 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#ifdef __GXX_RTTI
+#include <typeindex>
+#include <unordered_map>
+#endif
+
+/**
+ * @brief 不依赖 RTTI 的类型标识
+ * boost_typeindex.cc 用 typeid(T).name() 和 boost 的 type_id_with_cvr 得到类型的名字；
+ * 插件和消息分发中常见的写法是 std::unordered_map<std::type_index, handler>，每次查找都要对 mangled 名字
+ * 求哈希、比较字符串，而且 -fno-rtti 时根本不能用
+ *
+ * 1. type_name<T>()：constexpr，从 __PRETTY_FUNCTION__ 中截取出类型名（保留 cv 和引用，和 type_id_with_cvr 一样）
+ * 2. type_id_of<T>()：constexpr，类型名的 64 位 FNV-1a 哈希。同一个编译器的不同构建、不同进程之间是稳定的，
+ *    可以写进文件或者在网络上传输；不同的编译器对同一个类型给出的名字可能不同（例如 GCC 和 Clang 对匿名命名空间）
+ * 3. dense_id<T, Family>()：运行期在第一次使用时按顺序分配的 0, 1, 2...，同一个 Family 中连续，
+ *    适合做数组下标；不稳定，不能持久化
+ * 4. type_registry<V, Family>：以 dense_id 为下标的数组，查找就是一次数组访问
+ *    type_map<V>：以 type_id 为键的开放寻址哈希表，键是整数，不需要比较字符串
+ *
+ * 全部不使用 typeid，可以用 -fno-rtti 编译（此时测试中的 std::type_index 对照组会被跳过）
+ */
+
+namespace tid {
+
+template<typename T>
+constexpr std::string_view type_name() {
+  std::string_view s = __PRETTY_FUNCTION__;
+  std::size_t begin = s.find("T = ") + 4;
+  std::size_t end = s.find(';', begin);  // GCC: [with T = ...; std::string_view = ...]
+  if(end == std::string_view::npos)
+    end = s.rfind(']');                  // Clang: [T = ...]
+  return s.substr(begin, end - begin);
+}
+
+constexpr std::uint64_t fnv1a(std::string_view s) {
+  std::uint64_t h = 14695981039346656037ull;
+  for(char c : s) {
+    h ^= static_cast<unsigned char>(c);
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+struct type_id {
+  std::uint64_t value;
+
+  friend constexpr bool operator==(type_id a, type_id b) { return a.value == b.value; }
+  friend constexpr bool operator!=(type_id a, type_id b) { return a.value != b.value; }
+  friend constexpr bool operator<(type_id a, type_id b) { return a.value < b.value; }
+};
+
+template<typename T>
+constexpr type_id type_id_of() { return {fnv1a(type_name<T>())}; }
+
+/* 一组类型的哈希两两不同，可以放进 static_assert */
+template<typename... Ts>
+constexpr bool distinct_ids() {
+  constexpr std::uint64_t ids[] = {type_id_of<Ts>().value..., 0};
+  for(std::size_t i = 0; i < sizeof...(Ts); ++i)
+    for(std::size_t j = i + 1; j < sizeof...(Ts); ++j)
+      if(ids[i] == ids[j])
+        return false;
+  return true;
+}
+
+/* ---- 稠密编号 ---- */
+template<typename Family>
+class dense_counter {
+  template<typename T, typename F>
+  friend std::size_t dense_id();
+
+public:
+  static std::size_t count() noexcept { return next.load(std::memory_order_relaxed); }
+
+private:
+  static inline std::atomic<std::size_t> next{0};
+};
+
+template<typename T, typename Family = void>
+std::size_t dense_id() {
+  static const std::size_t id = dense_counter<Family>::next.fetch_add(1, std::memory_order_relaxed);
+  return id;
+}
+
+/* 以稠密编号为下标的注册表 */
+template<typename V, typename Family = void>
+class type_registry {
+public:
+  template<typename T>
+  void set(V v) {
+    std::size_t i = dense_id<T, Family>();
+    if(i >= slots.size())
+      slots.resize(dense_counter<Family>::count());
+    slots[i] = std::move(v);
+  }
+
+  template<typename T>
+  V* find() noexcept { return find(dense_id<T, Family>()); }
+
+  V* find(std::size_t id) noexcept { return id < slots.size() && slots[id] ? &slots[id] : nullptr; }
+
+private:
+  std::vector<V> slots;
+};
+
+/* 以 type_id 为键的开放寻址哈希表；插入时检查哈希冲突 */
+template<typename V>
+class type_map {
+public:
+  explicit type_map(std::size_t capacity = 16) : slots(next_pow2(capacity * 2)) {}
+
+  template<typename T>
+  void set(V v) { insert(type_id_of<T>(), type_name<T>(), std::move(v)); }
+
+  template<typename T>
+  V* find() noexcept { return find(type_id_of<T>()); }
+
+  V* find(type_id id) noexcept {
+    std::size_t mask = slots.size() - 1;
+    for(std::size_t i = mix(id.value) & mask;; i = (i + 1) & mask) {
+      slot &s = slots[i];
+      if(s.id == id && s.used)
+        return &s.value;
+      if(!s.used)
+        return nullptr;
+    }
+  }
+
+private:
+  struct slot {
+    type_id id{0};
+    std::string_view name;
+    bool used = false;
+    V value{};
+  };
+
+  static std::size_t next_pow2(std::size_t n) {
+    std::size_t p = 1;
+    while(p < n)
+      p <<= 1;
+    return p;
+  }
+  static std::size_t mix(std::uint64_t h) { return static_cast<std::size_t>(h ^ (h >> 29)); }
+
+  void insert(type_id id, std::string_view name, V v) {
+    if((size + 1) * 2 > slots.size())
+      rehash(slots.size() * 2);
+    std::size_t mask = slots.size() - 1;
+    for(std::size_t i = mix(id.value) & mask;; i = (i + 1) & mask) {
+      slot &s = slots[i];
+      if(!s.used) {
+        s = {id, name, true, std::move(v)};
+        ++size;
+        return;
+      }
+      if(s.id == id) {
+        if(s.name != name)
+          throw std::logic_error("type_id collision between " + std::string(s.name) + " and " + std::string(name));
+        s.value = std::move(v);
+        return;
+      }
+    }
+  }
+
+  void rehash(std::size_t n) {
+    std::vector<slot> old(n);
+    old.swap(slots);
+    size = 0;
+    for(slot &s : old)
+      if(s.used)
+        insert(s.id, s.name, std::move(s.value));
+  }
+
+  std::vector<slot> slots;
+  std::size_t size = 0;
+};
+
+}  // namespace tid
+
+/* ------------------------------ 测试 ------------------------------ */
+struct Widget {
+  int a;
+  int b;
+};
+
+namespace net {
+struct login {};
+struct logout {};
+template<typename T>
+struct envelope {};
+}  // namespace net
+
+static_assert(tid::type_name<int>() == "int", "");
+static_assert(tid::type_name<const Widget*>() == "const Widget*", "");
+static_assert(tid::type_id_of<net::envelope<net::login>>() != tid::type_id_of<net::envelope<net::logout>>(), "");
+static_assert(tid::distinct_ids<int, unsigned, int&, const int, Widget, net::login, net::logout>(), "");
+
+/* 消息带着自己的类型编号，按编号分发不需要 typeid，-fno-rtti 下也能工作 */
+struct message {
+  message(tid::type_id id, std::size_t dense) : id(id), dense(dense) {}
+
+  tid::type_id id;
+  std::size_t dense;
+  virtual ~message() = default;
+};
+
+template<typename Derived>
+struct message_of : message {
+  message_of() : message(tid::type_id_of<Derived>(), tid::dense_id<Derived, message>()) {}
+};
+
+template<int N>
+struct msg : message_of<msg<N>> {
+  int payload = N;
+};
+
+using handler = std::function<void(message&)>;
+using ns = std::chrono::duration<double, std::nano>;
+
+constexpr int kKinds = 16;
+
+template<int... N>
+std::vector<std::unique_ptr<message>> make_messages(std::size_t n, std::integer_sequence<int, N...>) {
+  using factory = std::unique_ptr<message> (*)();
+  factory make[] = {[]() -> std::unique_ptr<message> { return std::make_unique<msg<N>>(); }...};
+  std::vector<std::unique_ptr<message>> out;
+  std::uint32_t x = 2463534242u;
+  for(std::size_t i = 0; i < n; ++i) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    out.push_back(make[x % sizeof...(N)]());
+  }
+  return out;
+}
+
+template<typename Dispatch>
+double bench(const std::vector<std::unique_ptr<message>> &msgs, Dispatch dispatch) {
+  auto t0 = std::chrono::steady_clock::now();
+  for(int round = 0; round < 10; ++round)
+    for(auto &m : msgs)
+      dispatch(*m);
+  return ns(std::chrono::steady_clock::now() - t0).count() / (10.0 * msgs.size());
+}
+
+template<int... N>
+void run(std::integer_sequence<int, N...> kinds) {
+  long sum = 0;
+  handler handlers[] = {[&sum](message &m) { sum += static_cast<msg<N>&>(m).payload; }...};
+
+  tid::type_registry<handler, message> registry;
+  tid::type_map<handler> by_hash;
+  (registry.set<msg<N>>(handlers[N]), ...);
+  (by_hash.set<msg<N>>(handlers[N]), ...);
+
+  auto msgs = make_messages(1 << 20, kinds);
+  std::cout << std::fixed << std::setprecision(2);
+  std::cout << "  dense registry:          " << bench(msgs, [&](message &m) { (*registry.find(m.dense))(m); }) << " ns\n";
+  std::cout << "  type_id hash map:        " << bench(msgs, [&](message &m) { (*by_hash.find(m.id))(m); }) << " ns\n";
+#ifdef __GXX_RTTI
+  std::unordered_map<std::type_index, handler> by_index;
+  ((by_index[std::type_index(typeid(msg<N>))] = handlers[N]), ...);
+  std::cout << "  unordered_map<type_index>: " << bench(msgs, [&](message &m) { by_index.find(typeid(m))->second(m); })
+            << " ns\n";
+#else
+  std::cout << "  unordered_map<type_index>: skipped (-fno-rtti)\n";
+#endif
+  std::cout.unsetf(std::ios::fixed);
+  std::cout << "  (checksum " << sum << ")\n";
+}
+
+int main() {
+  std::cout << "type_name<const Widget*>(): " << tid::type_name<const Widget*>() << "\n"
+            << "type_name<net::envelope<net::login>>(): " << tid::type_name<net::envelope<net::login>>() << "\n"
+            << "type_id_of<Widget>(): 0x" << std::hex << tid::type_id_of<Widget>().value << std::dec << "\n";
+
+  /* 稠密编号按第一次使用的顺序分配，不同的 Family 各自从 0 开始 */
+  struct plugins {};
+  std::cout << "dense ids: Widget " << tid::dense_id<Widget, plugins>() << ", int " << tid::dense_id<int, plugins>()
+            << ", Widget again " << tid::dense_id<Widget, plugins>() << "\n";
+
+  std::cout << "\ndispatch " << kKinds << " message kinds, per message:\n";
+  run(std::make_integer_sequence<int, kKinds>{});
+}